@@ -28,6 +28,14 @@ position(position)
 
     // remember the initial position for repetitions
     search.repetitions.push_back(position.hash);
+    // search with every core we have
+    search.setThreads((int)std::thread::hardware_concurrency());
+    // the game searches the same table for a long time, so set it up with huge pages before the clock starts
+    search.setHashSize(ENGINE_HASH, true);
+    // start the engine's clock
+    engineClock.timeLeft = ENGINE_TIME;
+    engineClock.increment = ENGINE_INCREMENT;
+    engineClock.movesToGo = 0;
 
     // we are not deciding what piece to promote to
     isPromoting = false;
@@ -512,8 +520,15 @@ void ChessGame::run()
             // if it is the engine's turn
             if (position.isEngineMove)
             {
-                // spend a minimum of three seconds calculating a move...
-                Move engineMove = search.getBestMove(3000);
+                // let the time manager decide how long to think, given the time left on the clock
+                auto thinkStart = std::chrono::steady_clock::now();
+                Move engineMove = search.getBestMove(engineClock);
+                // the time we spent thinking comes off the clock, and then we get the increment
+                engineClock.timeLeft -= (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - thinkStart).count();
+                engineClock.timeLeft += engineClock.increment;
+                // nobody flags the engine, so an overrun just leaves it playing on an empty clock
+                engineClock.timeLeft = std::max(engineClock.timeLeft, 0);
                 /*
                  * we just spend many seconds searching for the best move.
                  * meanwhile, the player might have been dragging the left mouse
@@ -34,6 +34,9 @@ private:
     Search search;
     Position& position;
 
+    // the clock the engine has left to think with
+    GameClock engineClock;
+
     // a vector to represent our graphical board
     std::vector<SquareUI> board;
     // 12 preloaded piece textures plus one nullptr for a NONE piece
@@ -9,6 +9,12 @@ const int WINDOW_SIZE = 800;
 const int SQUARE_SIZE = WINDOW_SIZE / 8;
 const bool ENGINE_IS_WHITE = false;
 
+// the time control of the engine's clock, in milliseconds
+const int ENGINE_TIME = 5 * 60 * 1000;
+const int ENGINE_INCREMENT = 3 * 1000;
+// the size of the engine's transposition table, in megabytes
+const int ENGINE_HASH = 256;
+
 const int DARK_SQUARE_COLOR = 0x222222;
 const int LIGHT_SQUARE_COLOR = 0x777777;
 const int CHECKING_SQUARE_COLOR = 0xff3131;
@@ -279,29 +279,6 @@ void MoveGen::updateSafeSquares()
     safeSquares = ~safeSquares;
 }
 
-/*
- * use the magic bitboards defined in Magics.h to calculate a small hash.
- * this hash is derived by bit-shifting the result of a multiplication
- * between the blocking pieces and a pre-calculated magic number.
- * we can then use this hash to lookup the correct attack set in an attack table.
- *
- * This function returns moves for a sliding piece given its square
- * https://www.chessprogramming.org/Magic_Bitboards
- */
-template<bool isCardinal>
-Bitboard MoveGen::getSlidingMoves(Square from)
-{
-    if (isCardinal)
-    {
-        return CARDINAL_ATTACKS
-            [from]
-            [(CARDINAL_BLOCKERS[from] & position.occupied) * CARDINAL_MAGICS[from] >> 52];
-    }
-    return ORDINAL_ATTACKS
-        [from]
-        [(ORDINAL_BLOCKERS[from] & position.occupied) * ORDINAL_MAGICS[from] >> 55];
-}
-
 /*
  * knights are pretty easy. they just leap from one square to another,
  * so they can be implemented with a single bitboard in an array lookup.
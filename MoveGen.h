@@ -52,6 +52,66 @@ public:
         return pawns | knights | bishops | rooks | queens;
     }
 
+    /*
+     * get a bitboard of the pieces of both sides that attack the given square.
+     * sliding pieces are blocked by the given occupied squares instead of the
+     * pieces on the board, so removing a piece from the occupied squares reveals
+     * the sliding pieces behind it (x-rays). the caller has to mask out pieces
+     * that are no longer on the occupied squares
+     * https://www.chessprogramming.org/Square_Attacked_By#AnyAttackBySide
+     */
+    Bitboard attackersTo(Square square, Bitboard occupied)
+    {
+        Bitboard knights = position.pieces[ENGINE_KNIGHT] | position.pieces[PLAYER_KNIGHT];
+        Bitboard kings = position.pieces[ENGINE_KING] | position.pieces[PLAYER_KING];
+        Bitboard queens = position.pieces[ENGINE_QUEEN] | position.pieces[PLAYER_QUEEN];
+        Bitboard rooks = position.pieces[ENGINE_ROOK] | position.pieces[PLAYER_ROOK] | queens;
+        Bitboard bishops = position.pieces[ENGINE_BISHOP] | position.pieces[PLAYER_BISHOP] | queens;
+
+        // a pawn attacks a square if a pawn of the other side on that square would attack the pawn
+        return (ENGINE_PAWN_CAPTURES[square] & position.pieces[PLAYER_PAWN]) |
+               (PLAYER_PAWN_CAPTURES[square] & position.pieces[ENGINE_PAWN]) |
+               (KNIGHT_MOVES[square] & knights) |
+               (KING_MOVES[square] & kings) |
+               (getSlidingMoves<true>(square, occupied) & rooks) |
+               (getSlidingMoves<false>(square, occupied) & bishops);
+    }
+
+    /*
+     * return true if the piece moved by the given move attacks the enemy king from its new square.
+     * this is cheaper than making the move, but discovered checks are not detected
+     */
+    bool isDirectCheck(Move move)
+    {
+        PieceType pieceMoved = getPieceMoved(move);
+        bool isEngine = pieceMoved >= ENGINE_PAWN;
+        Square to = getSquareTo(move);
+        Bitboard occupied = (position.occupied ^ toBoard(getSquareFrom(move))) | toBoard(to);
+
+        Bitboard attacks = 0;
+        switch (isEngine ? pieceMoved - ENGINE_PAWN : pieceMoved)
+        {
+            case PLAYER_PAWN:
+                attacks = isEngine ? ENGINE_PAWN_CAPTURES[to] : PLAYER_PAWN_CAPTURES[to];
+                break;
+            case PLAYER_KNIGHT:
+                attacks = KNIGHT_MOVES[to];
+                break;
+            case PLAYER_BISHOP:
+                attacks = getSlidingMoves<false>(to, occupied);
+                break;
+            case PLAYER_ROOK:
+                attacks = getSlidingMoves<true>(to, occupied);
+                break;
+            case PLAYER_QUEEN:
+                attacks = getSlidingMoves<false>(to, occupied) | getSlidingMoves<true>(to, occupied);
+                break;
+            default:
+                break;
+        }
+        return attacks & position.pieces[isEngine ? PLAYER_KING : ENGINE_KING];
+    }
+
 private:
 
     template<bool isEngine>
@@ -90,8 +150,35 @@ private:
     template<bool isEngine, bool quiets>
     void genQueenMoves();
 
+    /*
+     * use the magic bitboards defined in Magics.h to calculate a small hash.
+     * this hash is derived by bit-shifting the result of a multiplication
+     * between the blocking pieces and a pre-calculated magic number.
+     * we can then use this hash to lookup the correct attack set in an attack table.
+     *
+     * This function returns moves for a sliding piece given its square
+     * https://www.chessprogramming.org/Magic_Bitboards
+     */
     template<bool isCardinal>
-    Bitboard getSlidingMoves(Square from);
+    Bitboard getSlidingMoves(Square from)
+    {
+        return getSlidingMoves<isCardinal>(from, position.occupied);
+    }
+
+    // moves for a sliding piece given its square and the squares that block it
+    template<bool isCardinal>
+    Bitboard getSlidingMoves(Square from, Bitboard occupied)
+    {
+        if (isCardinal)
+        {
+            return CARDINAL_ATTACKS
+                [from]
+                [(CARDINAL_BLOCKERS[from] & occupied) * CARDINAL_MAGICS[from] >> 52];
+        }
+        return ORDINAL_ATTACKS
+            [from]
+            [(ORDINAL_BLOCKERS[from] & occupied) * ORDINAL_MAGICS[from] >> 55];
+    }
 
 };
 
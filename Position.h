@@ -470,6 +470,36 @@ public:
         isEngineMove = !isEngineMove;
     }
 
+    /*
+     * pass the turn to the other side without moving a piece.
+     * this is not a legal chess move, it is used by the search for null move pruning.
+     * an en passant capture is not possible after a null move, so it is removed
+     * https://www.chessprogramming.org/Null_Move
+     */
+    void makeNullMove()
+    {
+        rights.halfMoveClock++;
+        if (rights.enPassantCapture)
+        {
+            hash ^= EN_PASSANT_KEYS[getFile(toSquare(rights.enPassantCapture))];
+            rights.enPassantCapture = EMPTY_BITBOARD;
+        }
+        hash ^= ENGINE_TO_MOVE_KEY;
+        isEngineMove = !isEngineMove;
+    }
+
+    // undo a null move, given the rights of the position before the null move was made
+    void unMakeNullMove(PositionRights& previousRights)
+    {
+        if (previousRights.enPassantCapture)
+        {
+            hash ^= EN_PASSANT_KEYS[getFile(toSquare(previousRights.enPassantCapture))];
+        }
+        rights = previousRights;
+        hash ^= ENGINE_TO_MOVE_KEY;
+        isEngineMove = !isEngineMove;
+    }
+
 private:
     void readFen(const std::string& fen);
 
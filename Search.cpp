@@ -7,21 +7,213 @@
 Search::Search(Position& position) :
 moveGen(position),
 position(position),
-evaluator(position)
+table(new TranspositionTable(ENGINE_HASH)),
+transpositions(*table),
+evaluator(position),
+stopFlag(false),
+stopped(stopFlag),
+continuationHistory(NONE * 64 * NONE * 64)
 {
+    init();
+}
+
+Search::Search(Position& position, TranspositionTable& transpositions, std::atomic<bool>& stopped) :
+moveGen(position),
+position(position),
+transpositions(transpositions),
+evaluator(position),
+stopFlag(false),
+stopped(stopped),
+continuationHistory(NONE * 64 * NONE * 64)
+{
+    init();
+}
+
+void Search::init()
+{
+    initLateMoveReductions();
+    std::fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, NULL_MOVE);
+    std::fill(&history[0][0][0], &history[0][0][0] + 2 * 64 * 64, 0);
+    std::fill(&moveStack[0], &moveStack[0] + MAX_PLY, NULL_MOVE);
+    std::fill(&counterMoves[0][0], &counterMoves[0][0] + NONE * 64, NULL_MOVE);
+}
+
+/*
+ * the reduction grows with both the remaining depth and the index of the move in the move list.
+ * growing logarithmically with both keeps the reductions small near the leaves and near
+ * the front of the move list, where the moves are most likely to matter
+ */
+void Search::initLateMoveReductions()
+{
+    for (int depth = 0; depth < 64; depth++)
+    {
+        for (int moveIndex = 0; moveIndex < 64; moveIndex++)
+        {
+            lateMoveReductions[depth][moveIndex] = depth && moveIndex
+                ? (int)(0.75 + std::log(depth) * std::log(moveIndex) / 2.25)
+                : 0;
+        }
+    }
+}
+
+void Search::setThreads(int threads)
+{
+    numThreads = std::max(threads, 1);
+}
+
+void Search::setHashSize(int megabytes, bool isHugePages)
+{
+    transpositions.resize(std::max(megabytes, 1), isHugePages);
+}
+
+bool Search::saveHash(std::string path)
+{
+    return transpositions.saveFile(path);
+}
+
+bool Search::loadHash(std::string path)
+{
+    return transpositions.loadFile(path);
+}
+
+void Search::setInternalIteration(InternalIteration mode)
+{
+    internalIteration = mode;
+}
+
+long long Search::getNodesSearched()
+{
+    return nodesSearched;
+}
+
+std::vector<Move> Search::getPrincipalVariation()
+{
+    return principalVariation;
+}
+
+void Search::setMultiPv(int lines)
+{
+    numLines = std::max(lines, 1);
+}
+
+std::vector<Search::AnalysisLine> Search::getAnalysisLines()
+{
+    return analysisLines;
+}
+
+void Search::reportIteration(int depth)
+{
+    int elapsed = timeManager.getElapsed();
+    for (int line = 0; line < analysisLines.size(); line++)
+    {
+        std::cout << "depth " << depth;
+        std::cout << " seldepth " << selectiveDepth;
+        if (numLines > 1)
+        {
+            std::cout << " multipv " << line + 1;
+        }
+        std::cout << " score " << analysisLines[line].score;
+        std::cout << " nodes " << nodesSearched;
+        std::cout << " nps " << nodesSearched * 1000 / std::max(elapsed, 1);
+        std::cout << " pv";
+        for (Move move : analysisLines[line].principalVariation)
+        {
+            std::cout << " " << moves::toNotation(move);
+        }
+        std::cout << std::endl;
+    }
+}
+
+void Search::ageHistory()
+{
+    for (int side = 0; side < 2; side++)
+    {
+        for (int from = A1; from <= H8; from++)
+        {
+            for (int to = A1; to <= H8; to++)
+            {
+                history[side][from][to] /= 2;
+            }
+        }
+    }
+    for (int& score : continuationHistory)
+    {
+        score /= 2;
+    }
+}
+
+int Search::staticExchange(Move move)
+{
+    Square square = getSquareTo(move);
+    Bitboard occupied = position.occupied;
+    Bitboard attackers = moveGen.attackersTo(square, occupied);
+
+    // the material balance after each capture on the square, from the point of view of the side that captured
+    int gains[32];
+    int numCaptures = 0;
+    gains[0] = PIECE_SCORES[getPieceCaptured(move)];
+
+    Bitboard attacker = toBoard(getSquareFrom(move));
+    PieceType pieceMoved = getPieceMoved(move);
+    bool isEngine = pieceMoved >= ENGINE_PAWN;
+    while (true)
+    {
+        numCaptures++;
+        // the next capture wins the piece that just captured
+        gains[numCaptures] = getExchangeScore(pieceMoved) - gains[numCaptures - 1];
+        // if neither side can come out ahead by continuing, the result can not change anymore
+        if (std::max(-gains[numCaptures - 1], gains[numCaptures]) < 0)
+        {
+            break;
+        }
+        // remove the piece that just captured, which might reveal a sliding piece behind it
+        occupied ^= attacker;
+        attackers = moveGen.attackersTo(square, occupied) & occupied;
+        isEngine = !isEngine;
+
+        // find the least valuable piece of the side to capture that attacks the square
+        attacker = 0;
+        for (int piece = isEngine ? ENGINE_PAWN : PLAYER_PAWN; piece <= (isEngine ? ENGINE_KING : PLAYER_KING); piece++)
+        {
+            Bitboard pieces = attackers & position.pieces[piece];
+            if (pieces)
+            {
+                attacker = toBoard(toSquare(pieces));
+                pieceMoved = (PieceType)piece;
+                break;
+            }
+        }
+        if (!attacker)
+        {
+            break;
+        }
+    }
+    // go back through the captures. each side can choose to stop capturing if continuing loses material
+    while (--numCaptures)
+    {
+        gains[numCaptures - 1] = -std::max(-gains[numCaptures - 1], gains[numCaptures]);
+    }
+    return gains[0];
 }
 
 /*
  * search the current position recursively depth first, using the
  * negamax algorithm with alpha beta pruning and a transposition table
  */
-int Search::negamax(int depth, int alpha, int beta)
+int Search::negamax(int depth, int ply, int alpha, int beta, bool isNullMoveAllowed, Move excludedMove)
 {
     nodesSearched++;
     bool isEngineMove = position.isEngineMove;
+    startPrincipalVariation(ply);
+
+    // if we ran out of time, the result of this node does not matter anymore
+    if (isStopping())
+    {
+        return 0;
+    }
 
     /*
-     * if the position is a draw by threefold repetition, or by the fifty move rule,
+     * if the position is a draw by repetition, or by the fifty move rule,
      * return the contempt value immediately. We do this before probing the transposition
      * table because we want to make sure it is not possible for a drawn position to end
      * up in the table, because the zobrist hash does not know about draw by threefold
@@ -30,7 +222,7 @@ int Search::negamax(int depth, int alpha, int beta)
      * these types of positions to the hash table may result in search instability.
      * https://www.chessprogramming.org/Search_Instability
      */
-    if (repeated() || position.rights.halfMoveClock >= 50)
+    if (repeated(ply) || position.rights.halfMoveClock >= 50)
     {
         /*
          * the contempt value is equal to the amount of evaluation the engine
@@ -40,31 +232,29 @@ int Search::negamax(int depth, int alpha, int beta)
         return -CONTEMPT;
     }
 
-    // look up the current position in the transposition table
-    // https://www.chessprogramming.org/Transposition_Table
-    Node& currentNode = transpositions[int(position.hash % MAX_TRANSPOSITIONS)];
     /*
-     * we always want to overwrite the current node with new information.
-     * it does not matter if it is empty or occupied, index collisions are common,
-     * and the easiest way to fix them is to simply always overwrite the node
+     * mate distance pruning. even if we get mated right here, the score can not be lower than
+     * getting mated at this ply, and it can not be higher than mating the opponent on the next ply.
+     * if a shorter mate was already found elsewhere in the tree, the window collapses,
+     * and there is no reason to search for a longer one
+     * https://www.chessprogramming.org/Mate_Distance_Pruning
      */
-    if (currentNode.hash != position.hash)
+    alpha = std::max(alpha, MIN_EVAL + ply);
+    beta = std::min(beta, MAX_EVAL - ply - 1);
+    if (alpha >= beta)
     {
-        /*
-         * overwrite the transposition node with blank information, prepare it to be filled.
-         * We might be overwriting a valid node because of an index collision,
-         * but that is okay because this program uses the "always replace" scheme
-         * https://www.chessprogramming.org/Transposition_Table#Collisions
-         * https://www.chessprogramming.org/Transposition_Table#Always_Replace
-         */
-        currentNode.hash = position.hash;
-        currentNode.bestMove = NULL_MOVE;
-        currentNode.isLowerBound = false;
-        currentNode.isUpperBound = false;
-        currentNode.isExact = false;
-        currentNode.depth = (short)depth;
-        currentNode.evaluation = 0;
+        return alpha;
     }
+
+    // look up the current position in the transposition table
+    // https://www.chessprogramming.org/Transposition_Table
+    TranspositionTable::Entry tableEntry;
+    bool isTableHit = transpositions.probe(position.hash, tableEntry);
+    // the best move we found for this position last time, if we have been here before
+    Move tableMove = isTableHit ? tableEntry.bestMove : NULL_MOVE;
+    // the score in the table, with mate scores measured from the root again
+    int tableScore = isTableHit ? scoreFromTable(tableEntry.evaluation, ply) : 0;
+    Bound tableBound = isTableHit ? tableEntry.getBound() : NO_BOUND;
     /*
      * We can only use what we learned about the position if the depth
      * it was searched to last time is greater than or equal to the current
@@ -72,50 +262,193 @@ int Search::negamax(int depth, int alpha, int beta)
      * required depth, we can use the evaluation we calculated last time, which
      * has a good chance of pruning large branches off of the search graph
      */
-    else if (currentNode.depth >= depth)
+    /*
+     * a search that excludes a move is not a search of the whole position,
+     * so it can not use what we learned about the whole position either.
+     * principal variation nodes are always searched, so the principal variation
+     * is not cut short by the table, and exact scores are verified by a real search
+     */
+    if (isTableHit && tableEntry.depth >= depth && excludedMove == NULL_MOVE && beta - alpha == 1)
     {
         transpositionHits++;
         // if this node is a PV node or has been statically evaluated
-        if (currentNode.isExact)
+        if (tableBound == EXACT_BOUND)
         {
             // we don't need to search it again
-            return currentNode.evaluation;
+            return tableScore;
         }
         // if the best move we found last time was lower than the old alpha,
         // but is greater than the current alpha
-        else if (currentNode.isLowerBound && currentNode.evaluation > alpha)
+        else if (tableBound == LOWER_BOUND && tableScore > alpha)
         {
             // increase the lower bound
-            alpha = currentNode.evaluation;
+            alpha = tableScore;
         }
         // if the best move we found last time was higher than the old beta,
         // but is less than the current beta
-        else if (currentNode.isUpperBound && currentNode.evaluation < beta)
+        else if (tableBound == UPPER_BOUND && tableScore < beta)
         {
             // decrease the upper bound
-            beta = currentNode.evaluation;
+            beta = tableScore;
         }
         // if what we learned last time caused the window to collapse
         if (alpha >= beta)
         {
             // return the exact bound we calculated last time
-            return currentNode.evaluation;
+            return tableScore;
         }
     }
 
+    /*
+     * if this node is on the principal variation of the last iteration, but the table
+     * lost its best move, use the move from the principal variation instead
+     */
+    if (tableMove == NULL_MOVE && isOnPrincipalVariation(ply))
+    {
+        tableMove = principalVariation[ply];
+    }
+
     // if the current node is a leaf node
     if (!depth)
     {
-        // if the current node has not already been statically evaluated
-        if (!currentNode.isExact)
+        // depth is zero, so only search captures until the position is quiet
+        return quiesce(ply, alpha, beta);
+    }
+
+    bool isInCheck = isEngineMove ? moveGen.getCheckers<true>() : moveGen.getCheckers<false>();
+    bool isPrincipalVariation = beta - alpha > 1;
+    // the static evaluation means nothing while in check, because we might be losing a lot of material
+    int staticEval = isInCheck ? MIN_EVAL : (isEngineMove ? evaluator.evaluate() : -evaluator.evaluate());
+
+    /*
+     * reverse futility pruning. near the leaves, if the static evaluation is so far above beta
+     * that the opponent can not hope to catch up within the remaining depth, assume the node fails high.
+     * this is the same idea as futility pruning, applied to the node instead of a single move
+     * https://www.chessprogramming.org/Reverse_Futility_Pruning
+     */
+    if (!isPrincipalVariation &&
+        !isInCheck &&
+        depth <= REVERSE_FUTILITY_DEPTH &&
+        !isMateScore(beta) &&
+        staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta)
+    {
+        return staticEval;
+    }
+
+    /*
+     * razoring. near the leaves, if the static evaluation is so far below alpha that only
+     * a capture could bring it back, skip the quiet moves and go straight to the quiescence search.
+     * we only trust the quiescence search if it fails low too
+     * https://www.chessprogramming.org/Razoring
+     */
+    if (!isPrincipalVariation &&
+        !isInCheck &&
+        depth <= RAZOR_DEPTH &&
+        !isMateScore(alpha) &&
+        staticEval + RAZOR_MARGIN * depth <= alpha)
+    {
+        int score = quiesce(ply, alpha, alpha + 1);
+        if (stopped)
+        {
+            return 0;
+        }
+        if (score <= alpha)
         {
-            nodesEvaluated++;
-            // statically evaluate the position and save it to the transposition table
-            currentNode.isExact = true;
-            currentNode.evaluation = (short)(isEngineMove ? evaluator.evaluate() : -evaluator.evaluate());
+            return score;
+        }
+    }
+
+    /*
+     * null move pruning. if we pass the turn and our opponent still can not bring
+     * the score below beta with a reduced depth search, our position is so good
+     * that actually making a move will almost certainly fail high too.
+     * this is not safe in zugzwang, where passing would be the best move. zugzwang
+     * mostly happens in pawn endings, so we never try a null move when we only have pawns,
+     * and we verify the cutoff with a normal reduced search when we have little material.
+     * we also can not pass the turn while in check, and we never make two null moves in a row
+     * https://www.chessprogramming.org/Null_Move_Pruning
+     */
+    Bitboard pieces = isEngineMove
+        ? position.pieces[ENGINE_KNIGHT] | position.pieces[ENGINE_BISHOP] | position.pieces[ENGINE_ROOK] | position.pieces[ENGINE_QUEEN]
+        : position.pieces[PLAYER_KNIGHT] | position.pieces[PLAYER_BISHOP] | position.pieces[PLAYER_ROOK] | position.pieces[PLAYER_QUEEN];
+    if (isNullMoveAllowed &&
+        !isInCheck &&
+        pieces &&
+        depth >= NULL_MOVE_DEPTH &&
+        !isMateScore(beta) &&
+        staticEval >= beta)
+    {
+        // search more shallowly the deeper we are
+        int reduction = depth > 6 ? 3 : 2;
+
+        PositionRights rights = position.rights;
+        position.makeNullMove();
+        transpositions.prefetch(position.hash);
+        if (ply < MAX_PLY)
+        {
+            moveStack[ply] = NULL_MOVE;
+        }
+        int lastNullMoveIndex = nullMoveIndex;
+        nullMoveIndex = (int)repetitions.size();
+        repetitions.push_back(position.hash);
+        int score = -negamax(std::max(depth - 1 - reduction, 0), ply + 1, -beta, -beta + 1, false);
+        repetitions.pop_back();
+        nullMoveIndex = lastNullMoveIndex;
+        position.unMakeNullMove(rights);
+
+        if (stopped)
+        {
+            return 0;
+        }
+        if (score >= beta)
+        {
+            // with little material, make sure we are not in zugzwang by searching without passing
+            if (countPieces(pieces) <= NULL_MOVE_VERIFY_PIECES)
+            {
+                score = negamax(std::max(depth - 1 - reduction, 0), ply, beta - 1, beta, false);
+                if (stopped)
+                {
+                    return 0;
+                }
+            }
+            if (score >= beta)
+            {
+                // don't return an unproven mate score
+                return isMateScore(score) ? beta : score;
+            }
+        }
+    }
+
+    /*
+     * without a best move from the transposition table, the first move we search
+     * is just a guess, and the whole node is likely to be searched badly.
+     * internal iterative deepening searches the node less deeply first, only to find
+     * a best move to try first. internal iterative reductions just search the node
+     * one ply less deeply, and trust the next iteration to find a best move for it
+     * https://www.chessprogramming.org/Internal_Iterative_Deepening
+     * https://www.chessprogramming.org/Internal_Iterative_Reductions
+     */
+    if (tableMove == NULL_MOVE &&
+        excludedMove == NULL_MOVE &&
+        depth >= INTERNAL_ITERATION_DEPTH)
+    {
+        if (internalIteration == INTERNAL_DEEPENING)
+        {
+            negamax(depth - INTERNAL_DEEPENING_REDUCTION, ply, alpha, beta, isNullMoveAllowed);
+            if (stopped)
+            {
+                return 0;
+            }
+            // the reduced search saved its best move to the table, unless it failed low
+            if (transpositions.probe(position.hash, tableEntry))
+            {
+                tableMove = tableEntry.bestMove;
+            }
+        }
+        else
+        {
+            depth--;
         }
-        // depth is zero, so no more searching
-        return currentNode.evaluation;
     }
 
     isEngineMove ? moveGen.genEngineMoves() : moveGen.genPlayerMoves();
@@ -129,17 +462,48 @@ int Search::negamax(int depth, int alpha, int beta)
     if (moveList.empty())
     {
         // if the king is safe
+        int score;
         if (position.pieces[isEngineMove ? ENGINE_KING : PLAYER_KING] & moveGen.safeSquares)
         {
             // stalemate
-            currentNode.evaluation = (short)-CONTEMPT;
+            score = -CONTEMPT;
         }
         else
         {
-            // checkmate
-            currentNode.evaluation = (short)(MIN_EVAL + MAX_DEPTH - depth);
+            // checkmate. the sooner the mate, the better it is for the side giving it
+            score = MIN_EVAL + ply;
+        }
+        // there is nothing left to search, so the score is exact at any depth
+        transpositions.save(position.hash, NULL_MOVE, scoreToTable(score, ply), depth, EXACT_BOUND);
+        return score;
+    }
+
+    /*
+     * singular extensions. if the best move from the transposition table is much better than
+     * every other move, the position is forcing, and the best move deserves a deeper search.
+     * to find out, search every other move with a reduced depth and a window just below the
+     * score of the best move. if they all fail low, the best move is singular.
+     * we only trust the table if it searched the node almost as deeply as we are about to
+     * https://www.chessprogramming.org/Singular_Extensions
+     */
+    Move singularMove = NULL_MOVE;
+    if (excludedMove == NULL_MOVE &&
+        depth >= SINGULAR_DEPTH &&
+        tableMove != NULL_MOVE &&
+        (tableBound == LOWER_BOUND || tableBound == EXACT_BOUND) &&
+        tableEntry.depth >= depth - 3 &&
+        !isMateScore(tableScore))
+    {
+        int singularBeta = tableScore - SINGULAR_MARGIN * depth;
+        int score = negamax((depth - 1) / 2, ply, singularBeta - 1, singularBeta, false, tableMove);
+        if (stopped)
+        {
+            return 0;
+        }
+        if (score < singularBeta)
+        {
+            singularMove = tableMove;
         }
-        return currentNode.evaluation;
     }
     /*
      * remember the best move we find, so we can add it to this node in the transposition table.
@@ -148,14 +512,65 @@ int Search::negamax(int depth, int alpha, int beta)
      */
     Move bestMove = NULL_MOVE;
     int bestScore = MIN_EVAL;
+    // remember the window we started with, so we know what type of node this is when we are done
+    int originalAlpha = alpha;
+    // the searches we did at this ply before the move loop left their own principal variation behind
+    startPrincipalVariation(ply);
     // select each move we generated according to a predefined order based on heuristics about chess
+    std::vector<int> moveScores;
+    scoreMoves(tableMove, moveList, moveScores, ply);
     int moveIndex = 0;
-    while (selectMove(currentNode.bestMove, moveList, moveIndex))
+    while (selectMove(moveList, moveScores, moveIndex))
     {
         Move& move = moveList[moveIndex++];
+        if (move == excludedMove)
+        {
+            continue;
+        }
+        bool isQuiet = getPieceCaptured(move) == NONE && getMoveType(move) < KNIGHT_PROMOTION;
+
+        /*
+         * prune quiet moves near the leaves without making them. we always search
+         * at least one move, so the node still gets a real score, and we never
+         * prune at principal variation nodes, while in check, or when mated.
+         * quiet checks are not pruned either, they are how most mating attacks start
+         */
+        if (isQuiet &&
+            !isPrincipalVariation &&
+            !isInCheck &&
+            bestScore > MIN_EVAL &&
+            !isMateScore(alpha) &&
+            !moveGen.isDirectCheck(move))
+        {
+            /*
+             * late move pruning. with good move ordering, a quiet move this late in
+             * the move list is almost never going to raise alpha this close to the leaves
+             * https://www.chessprogramming.org/Futility_Pruning#MoveCountBasedPruning
+             */
+            if (depth <= LATE_MOVE_PRUNING_DEPTH && moveIndex > LATE_MOVE_PRUNING_INDEX + depth * depth)
+            {
+                continue;
+            }
+            /*
+             * futility pruning. a quiet move does not change the material balance,
+             * so if the static evaluation plus a margin can not reach alpha, neither can the move
+             * https://www.chessprogramming.org/Futility_Pruning
+             */
+            if (depth <= FUTILITY_DEPTH && staticEval + FUTILITY_MARGIN * depth <= alpha)
+            {
+                continue;
+            }
+        }
+
+        // a check that simply loses the checking piece is not forcing, so it is not extended
+        bool isLosingCheck = moveGen.isDirectCheck(move) && staticExchange(move) < 0;
 
         // make the move
         PositionRights rights = position.rights;
+        if (ply < MAX_PLY)
+        {
+            moveStack[ply] = move;
+        }
         if (isEngineMove)
         {
             position.makeMove<true>(move);
@@ -164,9 +579,77 @@ int Search::negamax(int depth, int alpha, int beta)
         {
             position.makeMove<false>(move);
         }
+        // the child looks itself up in the table first thing, so start loading its bucket now
+        transpositions.prefetch(position.hash);
 
         repetitions.push_back(position.hash);
-        int score = -negamax(depth - 1, -beta, -alpha);
+
+        /*
+         * search extensions. moves that give check and singular moves are searched one ply deeper.
+         * every extension on the path from the root counts against the same budget, which grows
+         * with the depth of the iteration, so a long sequence of checks can not make the tree explode
+         * https://www.chessprogramming.org/Extensions
+         * https://www.chessprogramming.org/Check_Extensions
+         */
+        bool isCheck = position.isEngineMove ? moveGen.getCheckers<true>() : moveGen.getCheckers<false>();
+        int extension = 0;
+        if (((isCheck && !isLosingCheck) || move == singularMove) &&
+            pathExtensions < std::max(rootDepth / EXTENSION_DEPTH, 1))
+        {
+            extension = 1;
+        }
+        pathExtensions += extension;
+        int newDepth = depth - 1 + extension;
+
+        int score;
+        // search the first move with the full window, it is most likely the best move
+        if (moveIndex == 1)
+        {
+            score = -negamax(newDepth, ply + 1, -beta, -alpha);
+        }
+        else
+        {
+            /*
+             * try to prove this move is no better than the moves we already searched.
+             * a null window search is much cheaper than a full window search
+             * because almost every node fails high or low right away
+             * https://www.chessprogramming.org/Principal_Variation_Search
+             */
+            int reduction = 0;
+            /*
+             * late move reductions. moves ordered late are very unlikely to be good,
+             * so we search quiet moves that come late in the move list less deeply.
+             * captures, promotions, and moves that get out of or give check are never reduced
+             * https://www.chessprogramming.org/Late_Move_Reductions
+             */
+            if (depth >= LATE_MOVE_DEPTH &&
+                moveIndex > LATE_MOVE_INDEX &&
+                !isInCheck &&
+                isQuiet &&
+                !isCheck)
+            {
+                reduction = lateMoveReductions[std::min(depth, 63)][std::min(moveIndex, 63)];
+                // reduce principal variation nodes a little less
+                if (beta - alpha > 1)
+                {
+                    reduction--;
+                }
+                // always leave at least one ply to search
+                reduction = std::max(std::min(reduction, depth - 2), 0);
+            }
+            score = -negamax(newDepth - reduction, ply + 1, -alpha - 1, -alpha);
+            // if the reduced search beat alpha, we can not trust it. search again at full depth
+            if (reduction && score > alpha)
+            {
+                score = -negamax(newDepth, ply + 1, -alpha - 1, -alpha);
+            }
+            // if the move turned out to be better after all, search it again with the full window
+            if (score > alpha && score < beta)
+            {
+                score = -negamax(newDepth, ply + 1, -beta, -alpha);
+            }
+        }
+        pathExtensions -= extension;
         repetitions.pop_back();
 
         // unmake the move
@@ -178,6 +661,14 @@ int Search::negamax(int depth, int alpha, int beta)
         {
             position.unMakeMove<false>(move, rights);
         }
+        /*
+         * if the search was stopped while we searched this move, the score is meaningless.
+         * the move is already unmade, so just unwind without touching the transposition table
+         */
+        if (stopped)
+        {
+            return 0;
+        }
 
         // if we found a better score than the best one so far
         if (score > bestScore)
@@ -192,109 +683,591 @@ int Search::negamax(int depth, int alpha, int beta)
         {
             // update the lower bound for future searches
             alpha = score;
+            updatePrincipalVariation(ply, move);
         }
         // if our lower bound exceeded our upper bound
         if (alpha >= beta)
         {
+            betaCutoffs++;
+            if (moveIndex == 1)
+            {
+                firstMoveCutoffs++;
+            }
+            /*
+             * remember quiet moves that caused a cutoff. a quiet move that refutes one
+             * move at this ply probably refutes its siblings too, and a quiet move that
+             * causes cutoffs anywhere in the tree is probably a good move in general.
+             * https://www.chessprogramming.org/Killer_Heuristic
+             * https://www.chessprogramming.org/History_Heuristic
+             */
+            if (isQuiet)
+            {
+                if (ply < MAX_PLY && killers[ply][0] != move)
+                {
+                    killers[ply][1] = killers[ply][0];
+                    killers[ply][0] = move;
+                }
+                int& moveHistory = history[isEngineMove][getSquareFrom(move)][getSquareTo(move)];
+                moveHistory += depth * depth;
+                bool isHistoryFull = moveHistory > HISTORY_LIMIT;
+                /*
+                 * remember this move as the answer to the move that led here
+                 * https://www.chessprogramming.org/Countermove_Heuristic
+                 */
+                Move previousMove = getPreviousMove(ply);
+                if (previousMove != NULL_MOVE)
+                {
+                    counterMoves[getPieceMoved(previousMove)][getSquareTo(previousMove)] = move;
+                    int& moveContinuation = getContinuationHistory(previousMove, move);
+                    moveContinuation += depth * depth;
+                    isHistoryFull |= moveContinuation > HISTORY_LIMIT;
+                }
+                if (isHistoryFull)
+                {
+                    ageHistory();
+                }
+            }
             // no need to search any more moves
             break;
         }
     }
     // figure out the node type to save in the transposition table.
     // later we can use the node type to restrict the search window, pruning the tree
-    if (bestScore <= alpha)
+    Bound bound;
+    // if no move raised alpha, the true score of this node is at most the best score
+    if (bestScore <= originalAlpha)
     {
-        currentNode.isUpperBound = true;
-        currentNode.bestMove = bestMove;
+        bound = UPPER_BOUND;
+        // none of the moves is known to be best, so keep the one we tried first
+        bestMove = tableMove;
     }
+    // if a move caused a beta cutoff, the true score of this node is at least the best score
     else if (bestScore >= beta)
     {
-        currentNode.isLowerBound = true;
+        bound = LOWER_BOUND;
     }
     else
     {
-        currentNode.isExact = true;
-        currentNode.bestMove = bestMove;
+        bound = EXACT_BOUND;
+    }
+    // a search that excluded a move did not search the whole position, so it is not saved
+    if (excludedMove == NULL_MOVE)
+    {
+        transpositions.save(position.hash, bestMove, scoreToTable(bestScore, ply), depth, bound);
+    }
+    return bestScore;
+}
+
+/*
+ * search captures until the position is quiet, and only then evaluate it.
+ * if we evaluated positions in the middle of a capture sequence, the engine
+ * would happily play QxP without noticing the pawn is defended. that is the horizon effect
+ * https://www.chessprogramming.org/Quiescence_Search
+ * https://www.chessprogramming.org/Horizon_Effect
+ */
+int Search::quiesce(int ply, int alpha, int beta)
+{
+    nodesSearched++;
+    bool isEngineMove = position.isEngineMove;
+    startPrincipalVariation(ply);
+
+    if (isStopping())
+    {
+        return 0;
+    }
+
+    /*
+     * every evasion is searched while in check, and a quiet evasion can give check again,
+     * so a long enough sequence of checks would never end. stop at the deepest ply we keep
+     * track of, so the recursion is bounded and every mate score stays within MAX_PLY of the root
+     */
+    if (ply >= MAX_PLY)
+    {
+        nodesEvaluated++;
+        return isEngineMove ? evaluator.evaluate() : -evaluator.evaluate();
+    }
+
+    bool isInCheck = isEngineMove ? moveGen.getCheckers<true>() : moveGen.getCheckers<false>();
+    int standPat = MIN_EVAL;
+    // if we are in check, we are not allowed to stand pat, every evasion must be searched
+    if (isInCheck)
+    {
+        isEngineMove ? moveGen.genEngineMoves() : moveGen.genPlayerMoves();
+        if (moveGen.moveList.empty())
+        {
+            // checkmate
+            return MIN_EVAL + ply;
+        }
+    }
+    else
+    {
+        nodesEvaluated++;
+        /*
+         * the side to move is not forced to capture anything, so the static evaluation
+         * is a lower bound on the score of this node. this is called "standing pat"
+         * https://www.chessprogramming.org/Quiescence_Search#Standing_Pat
+         */
+        standPat = isEngineMove ? evaluator.evaluate() : -evaluator.evaluate();
+        if (standPat >= beta)
+        {
+            return standPat;
+        }
+        /*
+         * if capturing a queen can not bring us back up to alpha,
+         * no single capture can. this is delta pruning for the whole node
+         * https://www.chessprogramming.org/Delta_Pruning
+         */
+        if (standPat + PIECE_SCORES[ENGINE_QUEEN] + DELTA_MARGIN < alpha)
+        {
+            return standPat;
+        }
+        if (standPat > alpha)
+        {
+            alpha = standPat;
+        }
+        isEngineMove ? moveGen.genEngineCaptures() : moveGen.genPlayerCaptures();
+    }
+    std::vector<Move> moveList = moveGen.moveList;
+
+    int bestScore = standPat;
+    // there are no killer moves in the quiescence search
+    std::vector<int> moveScores;
+    scoreMoves(NULL_MOVE, moveList, moveScores, MAX_PLY);
+    int moveIndex = 0;
+    while (selectMove(moveList, moveScores, moveIndex))
+    {
+        int moveScore = moveScores[moveIndex];
+        Move& move = moveList[moveIndex++];
+
+        /*
+         * a capture that loses material according to static exchange evaluation
+         * is almost never good, and searching it only makes the quiescence search explode.
+         * promotions can gain much more than the exchange, so we always search them
+         */
+        if (!isInCheck &&
+            getMoveType(move) < KNIGHT_PROMOTION &&
+            moveScore < BAD_CAPTURE_SCORE)
+        {
+            continue;
+        }
+
+        /*
+         * if winning the captured piece can not bring us back up to alpha,
+         * there is no reason to search the capture. promotions can gain much
+         * more than the captured piece, so we always search them
+         */
+        if (!isInCheck &&
+            getMoveType(move) < KNIGHT_PROMOTION &&
+            standPat + PIECE_SCORES[getPieceCaptured(move)] + DELTA_MARGIN < alpha)
+        {
+            continue;
+        }
+
+        // make the move
+        PositionRights rights = position.rights;
+        if (isEngineMove)
+        {
+            position.makeMove<true>(move);
+        }
+        else
+        {
+            position.makeMove<false>(move);
+        }
+
+        int score = -quiesce(ply + 1, -beta, -alpha);
+
+        // unmake the move
+        if (isEngineMove)
+        {
+            position.unMakeMove<true>(move, rights);
+        }
+        else
+        {
+            position.unMakeMove<false>(move, rights);
+        }
+        if (stopped)
+        {
+            return 0;
+        }
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+        if (alpha >= beta)
+        {
+            break;
+        }
     }
-    currentNode.evaluation = (short)bestScore;
     return bestScore;
 }
 
 Move Search::getBestMove(int maxElapsed)
 {
-    int depthSearched = 0;
-    Move bestMove;
-    int startTime = std::clock() * 1000 / CLOCKS_PER_SEC;
+    return getBestMove(maxElapsed, MAX_DEPTH);
+}
+
+Move Search::getBestMove(int maxElapsed, int maxDepth)
+{
+    timeManager.startMove(maxElapsed);
+    return deepen(maxDepth);
+}
+
+Move Search::getBestMove(GameClock clock)
+{
+    timeManager.startMove(clock);
+    /*
+     * if there is only one legal move, there is nothing to think about, and the time is better
+     * saved for later moves. it is still searched one ply deep, so it gets a score and a line
+     */
+    moveGen.genEngineMoves();
+    return deepen(moveGen.moveList.size() == 1 ? 1 : MAX_DEPTH);
+}
+
+Move Search::deepen(int maxDepth)
+{
+    nodesSearched = 0;
+    nodesEvaluated = 0;
+    transpositionHits = 0;
+    betaCutoffs = 0;
+    firstMoveCutoffs = 0;
+
+    // killer moves from the last search are at the wrong plies now
+    std::fill(&killers[0][0], &killers[0][0] + MAX_PLY * 2, NULL_MOVE);
+    // the history from the last search is still useful, but it should not dominate
+    ageHistory();
+    // the entries from the last search are still useful, but they are the first to go
+    transpositions.newSearch();
+    // the lines from the last search belong to a different position
+    principalVariation.clear();
+    analysisLines.clear();
+
+    stopped = false;
+
+    moveGen.genEngineMoves();
+
+    /*
+     * the root moves are generated once, and kept in order between iterations.
+     * the first iteration searches them in the same order as any other node
+     */
+    std::vector<int> moveScores;
+    TranspositionTable::Entry rootEntry;
+    std::vector<Move> moveList = moveGen.moveList;
+    scoreMoves(transpositions.probe(position.hash, rootEntry) ? rootEntry.bestMove : NULL_MOVE, moveList, moveScores, 0);
+    rootMoves.clear();
+    for (int moveIndex = 0; selectMove(moveList, moveScores, moveIndex); moveIndex++)
+    {
+        rootMoves.push_back({moveList[moveIndex], MIN_EVAL, 0});
+    }
+
+    /*
+     * the first iteration is always searched to the end, no matter what the clock says,
+     * so there is always a legal move with a real score to play. it is so shallow that it
+     * takes next to no time, and it runs before the helpers start, so no other thread can stop it
+     */
+    isFirstIteration = true;
+    Move bestMove = iterate(1, NULL_MOVE);
+    isFirstIteration = false;
+    int depthSearched = 1;
+    reportIteration(1);
+    bool isDone = maxDepth <= 1 || timeManager.isSoftLimitReached(bestMove, rootScore);
+
+    /*
+     * start the helper threads. each one gets its own copy of the position,
+     * so it can make and unmake moves without disturbing the other threads.
+     * https://www.chessprogramming.org/Lazy_SMP
+     */
+    std::vector<std::unique_ptr<Position>> helperPositions;
+    std::vector<std::unique_ptr<Search>> helpers;
+    std::vector<std::thread> threads;
+    for (int threadId = 1; !isDone && threadId < numThreads; threadId++)
+    {
+        helperPositions.push_back(std::unique_ptr<Position>(new Position(position)));
+        helpers.push_back(std::unique_ptr<Search>(new Search(*helperPositions.back(), transpositions, stopped)));
+        helpers.back()->repetitions = repetitions;
+        helpers.back()->rootMoves = rootMoves;
+        helpers.back()->timeManager = timeManager;
+        helpers.back()->internalIteration = internalIteration;
+        std::copy(&history[0][0][0], &history[0][0][0] + 2 * 64 * 64, &helpers.back()->history[0][0][0]);
+        std::copy(&counterMoves[0][0], &counterMoves[0][0] + NONE * 64, &helpers.back()->counterMoves[0][0]);
+        helpers.back()->continuationHistory = continuationHistory;
+        threads.push_back(std::thread(&Search::helperSearch, helpers.back().get(), threadId, maxDepth));
+    }
+
     // while we still have time to search
-    for (int depth = 1; depth <= MAX_DEPTH; depth++)
+    for (int depth = 2; !isDone && depth <= maxDepth; depth++)
     {
-        Move move = iterate(depth, startTime, maxElapsed);
+        Move move = iterate(depth, bestMove);
 
-        // if we ran out of time
+        // if we ran out of time before a single root move was searched
         if (move == NULL_MOVE)
         {
             break;
         }
-        depthSearched = depth;
+        // a partially searched iteration still searched the last best move first,
+        // so the best move it found is at least as good as the last one
         bestMove = move;
+        // if we ran out of time during the iteration
+        if (stopped)
+        {
+            break;
+        }
+        depthSearched = depth;
+        reportIteration(depth);
+        // if the time manager thinks another iteration is not worth the time
+        if (timeManager.isSoftLimitReached(bestMove, rootScore))
+        {
+            break;
+        }
+    }
+    // the main thread is done, so tell the helpers to stop and wait for them
+    stopped = true;
+    for (int i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+        nodesSearched += helpers[i]->nodesSearched;
+        nodesEvaluated += helpers[i]->nodesEvaluated;
+        transpositionHits += helpers[i]->transpositionHits;
+        betaCutoffs += helpers[i]->betaCutoffs;
+        firstMoveCutoffs += helpers[i]->firstMoveCutoffs;
     }
+
+    /*
+     * the first iteration only comes up empty if the shared stop flag was raised from outside
+     * before it searched a single root move. the root moves are ordered, so play the first one
+     */
+    if (bestMove == NULL_MOVE)
+    {
+        bestMove = rootMoves.front().move;
+    }
+
     if (moves::isIrreversible(bestMove))
     {
         // clear the repetitions list. we can never get the old position again
         repetitions.clear();
     }
 
-    int endTime = std::clock() * 1000 / CLOCKS_PER_SEC;
+    int elapsed = timeManager.getElapsed();
     std::cout << "depth = " << depthSearched << std::endl;
-    std::cout << "ms elapsed = " << endTime - startTime << std::endl;
+    std::cout << "threads = " << numThreads << std::endl;
+    std::cout << "ms elapsed = " << elapsed << std::endl;
     std::cout << "nodes searched = " << nodesSearched << std::endl;
     std::cout << "nodes evaluated = " << nodesEvaluated << std::endl;
     std::cout << "transposition hits = " << transpositionHits << std::endl;
+    std::cout << "hash full = " << transpositions.getHashfull() / 10.0 << "%" << std::endl;
+    std::cout << "first move cutoffs = " << firstMoveCutoffs * 100 / std::max(betaCutoffs, 1LL) << "%" << std::endl;
+    std::cout << "nodes per second = " << nodesSearched * 1000 / std::max(elapsed, 1) << std::endl;
     std::cout << std::endl;
     return bestMove;
 }
 
-Move Search::iterate(int depth, int startTime, int maxElapsed)
+void Search::helperSearch(int threadId, int maxDepth)
 {
-    moveGen.genEngineMoves();
-    std::vector<Move> moveList = moveGen.moveList;
+    Move bestMove = NULL_MOVE;
+    for (int depth = 1 + threadId % 2; depth <= maxDepth; depth++)
+    {
+        bestMove = iterate(depth, bestMove);
+        // if we ran out of time, or the main thread finished
+        if (stopped)
+        {
+            break;
+        }
+    }
+}
+
+Move Search::iterate(int depth, Move previousBest)
+{
+    rootDepth = depth;
+    selectiveDepth = 0;
+    excludedRootMoves.clear();
+
+    /*
+     * in multi pv mode, search the root once for every line. each search excludes
+     * the root moves of the lines we already found, so it finds the next best move.
+     * the lines share the transposition table, so every search after the first is cheap
+     * https://www.chessprogramming.org/Principal_Variation#Multiple_PVs
+     */
+    std::vector<AnalysisLine> lines;
+    for (int line = 0; line < numLines; line++)
+    {
+        // search the move this line had last iteration first, with a window around its last score
+        Move lineBest = line ? NULL_MOVE : previousBest;
+        int lineScore = rootScore;
+        if (line && line < analysisLines.size())
+        {
+            lineBest = analysisLines[line].move;
+            lineScore = analysisLines[line].score;
+        }
+        Move move = aspirate(depth, lineBest, lineScore);
+        // if we ran out of time, or there are no root moves left for this line
+        if (move == NULL_MOVE || stopped)
+        {
+            if (!line)
+            {
+                return move;
+            }
+            break;
+        }
+        lines.push_back({move, lineScore, std::vector<Move>(&pvTable[0][0], &pvTable[0][0] + pvLength[0])});
+        excludedRootMoves.push_back(move);
+    }
+    // only keep the lines of an iteration where every line was searched
+    if (!stopped)
+    {
+        analysisLines = lines;
+        /*
+         * order the root moves for the next iteration, by their score and then by the size
+         * of their subtree. most root moves only have an upper bound for a score, but a move
+         * with a higher bound or a bigger subtree was harder to refute, so it is more likely
+         * to become the best move. the moves of the lines come first, in the order of the lines
+         */
+        std::stable_sort(rootMoves.begin(), rootMoves.end(), [](const RootMove& a, const RootMove& b)
+        {
+            return a.score > b.score || (a.score == b.score && a.nodes > b.nodes);
+        });
+        for (int line = (int)lines.size() - 1; line >= 0; line--)
+        {
+            moveToFront(lines[line].move);
+        }
+    }
+    rootScore = lines[0].score;
+    // remember the principal variation, the next iteration searches it first
+    principalVariation = lines[0].principalVariation;
+    return lines[0].move;
+}
+
+Move Search::aspirate(int depth, Move previousBest, int& score)
+{
+    int window = ASPIRATION_WINDOW;
+    int alpha = MIN_EVAL;
+    int beta = MAX_EVAL;
+    /*
+     * the score of this iteration is probably close to the score of the last one.
+     * searching with a narrow window around the last score prunes much more of the tree.
+     * if the score falls outside of the window, we have to widen it and search again
+     * https://www.chessprogramming.org/Aspiration_Windows
+     */
+    if (previousBest != NULL_MOVE)
+    {
+        alpha = std::max(score - window, MIN_EVAL);
+        beta = std::min(score + window, MAX_EVAL);
+    }
+    while (true)
+    {
+        Move bestMove = NULL_MOVE;
+        int windowScore = searchRoot(depth, alpha, beta, previousBest, bestMove);
+        // if we ran out of time, return the best move we are sure about
+        if (stopped)
+        {
+            return bestMove;
+        }
+        window *= 2;
+        // if every move failed low, the score is lower than we thought
+        if (windowScore <= alpha && alpha > MIN_EVAL)
+        {
+            alpha = std::max(windowScore - window, MIN_EVAL);
+        }
+        // if a move failed high, the score is higher than we thought
+        else if (windowScore >= beta && beta < MAX_EVAL)
+        {
+            beta = std::min(windowScore + window, MAX_EVAL);
+            // the move that failed high is probably the best move, so search it first
+            previousBest = bestMove;
+        }
+        else
+        {
+            score = windowScore;
+            return bestMove;
+        }
+    }
+}
+
+int Search::searchRoot(int depth, int alpha, int beta, Move previousBest, Move& bestMove)
+{
+    startPrincipalVariation(0);
     // if the engine is in checkmate or stalemate
-    if (moveList.empty())
+    if (rootMoves.empty())
     {
         // deal with this stuff later
         assert(false);
     }
-    int moveIndex = 0;
+    int originalAlpha = alpha;
+    int movesSearched = 0;
     int bestScore = MIN_EVAL;
-    Move bestMove = NULL_MOVE;
-    while (selectMove(NULL_MOVE, moveList, moveIndex))
+    // search the best move from the last iteration first, the other root moves are already ordered
+    moveToFront(previousBest);
+    for (RootMove& rootMove : rootMoves)
     {
-        Move move = moveList[moveIndex++];
-        // if we ran out of time during iterative deepening
-        if (std::clock() * 1000 / CLOCKS_PER_SEC - startTime > maxElapsed)
+        Move move = rootMove.move;
+        // in multi pv mode, the moves of the lines we already found are not searched again
+        if (std::find(excludedRootMoves.begin(), excludedRootMoves.end(), move) != excludedRootMoves.end())
         {
-            return NULL_MOVE;
+            continue;
         }
 
         // make the move
         PositionRights rights = position.rights;
+        moveStack[0] = move;
         position.makeMove<true>(move);
+        transpositions.prefetch(position.hash);
 
         repetitions.push_back(position.hash);
-        int score = -negamax(depth, MIN_EVAL, MAX_EVAL);
+        long long nodesBefore = nodesSearched;
+        int score;
+        if (++movesSearched == 1)
+        {
+            score = -negamax(depth, 1, -beta, -alpha);
+        }
+        else
+        {
+            // principal variation search, exactly like in negamax
+            score = -negamax(depth, 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta)
+            {
+                score = -negamax(depth, 1, -beta, -alpha);
+            }
+        }
         repetitions.pop_back();
+        rootMove.nodes = nodesSearched - nodesBefore;
 
+        // unmake the move
+        position.unMakeMove<true>(move, rights);
+
+        // if we ran out of time during iterative deepening, or another thread stopped the search
+        if (stopped)
+        {
+            // keep the best move among the root moves we finished searching
+            break;
+        }
+        rootMove.score = score;
         if (score > bestScore)
         {
             bestScore = score;
+        }
+        // only a move that raised alpha is proven to be better than the moves before it
+        if (score > alpha)
+        {
+            alpha = score;
             bestMove = move;
+            updatePrincipalVariation(0, move);
+        }
+        if (alpha >= beta)
+        {
+            break;
         }
-
-        // unmake the move
-        position.unMakeMove<true>(move, rights);
     }
-    nodesSearched = 0;
-    nodesEvaluated = 0;
-    transpositionHits = 0;
-    return bestMove;
+    // a search that excluded root moves did not search the whole position, so it is not saved
+    if (stopped || !excludedRootMoves.empty())
+    {
+        return bestScore;
+    }
+
+    // save the root to the transposition table, so the other threads can use it too
+    Bound bound = bestScore <= originalAlpha ? UPPER_BOUND : (bestScore >= beta ? LOWER_BOUND : EXACT_BOUND);
+    transpositions.save(position.hash, bound == UPPER_BOUND ? previousBest : bestMove, bestScore, depth + 1, bound);
+    return bestScore;
 }
@@ -6,7 +6,22 @@
 #define DEEPENING1_SEARCH_H
 
 #include "Evaluator.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+// how the search deals with nodes that have no best move in the transposition table
+enum InternalIteration
+{
+    INTERNAL_DEEPENING,
+    INTERNAL_REDUCTIONS
+};
 
 class Search
 {
@@ -14,6 +29,14 @@ public:
 
     Search(Position& position);
 
+    /*
+     * create a helper search for lazy SMP. the helper searches its own copy
+     * of the position, but it shares the transposition table and the stop
+     * flag with the main search that created it.
+     * https://www.chessprogramming.org/Lazy_SMP
+     */
+    Search(Position& position, TranspositionTable& transpositions, std::atomic<bool>& stopped);
+
     MoveGen moveGen;
     Position& position;
 
@@ -22,51 +45,89 @@ public:
      * this vector can be cleared out whenever an irreversible move is made.
      * when the engine or the player makes a move in the game (not in the search),
      * we check if the move is irreversible, if it is, we can clear the repetitions vector.
-     * In the search, we push and pop positions from the repetitions vector, but never clear it
+     * In the search, we push and pop positions from the repetitions vector, but never clear it.
+     * every ply of the search pushes a position, even a null move, so that the position
+     * with the same side to move is always exactly two entries further down
      */
     std::vector<Zobrist> repetitions;
     Move getBestMove(int maxElapsed);
+    // search until the time runs out or the given depth has been completed
+    Move getBestMove(int maxElapsed, int maxDepth);
+    // search for as long as the time manager thinks we can afford with the given clock
+    Move getBestMove(GameClock clock);
 
+    // set the number of threads searching in parallel, including the main thread
+    void setThreads(int threads);
     /*
-     * a struct that represents a position we already evaluated.
-     * by remembering what we already calculated, we can prune huge subtrees.
+     * set the size of the transposition table in megabytes. this empties the table,
+     * so it should be called between games, and never while a search is running.
+     * huge pages make probing a big table faster, but the table takes longer to set up
      */
-    struct Node
+    void setHashSize(int megabytes, bool isHugePages = false);
+    /*
+     * save the transposition table to a file, and load it back in a later process, so a long
+     * analysis can be stopped and resumed without starting over from an empty table.
+     * neither may be called while a search is running. they return false if the file could
+     * not be written, or if it could not be read or was written by an incompatible engine
+     */
+    bool saveHash(std::string path);
+    bool loadHash(std::string path);
+    // choose between internal iterative deepening and internal iterative reductions
+    void setInternalIteration(InternalIteration mode);
+    // the number of nodes searched by all threads during the last call to getBestMove()
+    long long getNodesSearched();
+    // the best line of play found by the last completed iteration, starting with the best move
+    std::vector<Move> getPrincipalVariation();
+
+    // one of the best root moves, with its own score and principal variation
+    struct AnalysisLine
     {
-        Zobrist hash; // to help detect hash collisions (two different zobrist keys hashing to the same index)
-        Move bestMove; // to help improve move ordering by using the last best move we calculated for this node
-        short depth; // to make sure we don't use the evaluation of a more shallowly searched node than the current node
-        short evaluation;
-        bool isLowerBound; // we could not find a move greater than alpha
-        bool isUpperBound; // we found a move greater than beta
-        bool isExact; // the evaluation for this node does not belong to a bound
+        Move move;
+        int score;
+        std::vector<Move> principalVariation;
     };
+    // search for this many of the best root moves instead of only the best one
+    void setMultiPv(int lines);
+    // the lines found by the last completed iteration, from best to worst
+    std::vector<AnalysisLine> getAnalysisLines();
 
     /*
-     * a hash table, indexed by position zobrist hash modulo table size, that
-     * holds information about previously evaluated nodes.
-     * https://www.chessprogramming.org/Transposition_Table
+     * the main search owns the transposition table, and helper searches only refer to it.
+     * a helper search does not allocate a table of its own.
      */
-    const int MAX_TRANSPOSITIONS = 16777213; // 2^24 - 3, the greatest prime number smaller than 2^24
-    std::vector<Node> transpositions = std::vector<Node>(MAX_TRANSPOSITIONS);
+    std::unique_ptr<TranspositionTable> table;
+    TranspositionTable& transpositions;
 
 
-    // return true if we repeated a position three times
-    inline bool repeated()
+    /*
+     * return true if the position on top of the repetitions stack is a draw by repetition.
+     * only positions since the last irreversible move and the last null move can ever come back,
+     * so the scan is bounded by the half move clock and the null move index, and it steps back
+     * two plies at a time, because a position with the other side to move can never be the same position.
+     * ply is the distance from the search root. outside of the search it is zero, and
+     * only a real threefold repetition counts. inside the search, repeating a position
+     * that is already on the search path is treated as a draw straight away, because
+     * whichever side could avoid the repetition would have done so the first time.
+     * https://www.chessprogramming.org/Repetitions
+     */
+    inline bool repeated(int ply = 0)
     {
-        if (!repetitions.empty())
+        int top = (int)repetitions.size() - 1;
+        int oldest = std::max(top - position.rights.halfMoveClock, nullMoveIndex);
+        int numRepetitions = 1;
+        // a position can come back four plies later at the earliest
+        for (int i = top - 4; i >= oldest; i -= 2)
         {
-            // start at one, because we already have one instance of the current position
-            int numRepetitions = 1;
-            Zobrist repetition = repetitions[repetitions.size() - 1];
-            for (int i = 0; i < repetitions.size() - 1; i++)
+            if (repetitions[i] == repetitions[top])
             {
-                if (repetitions[i] == repetition)
+                // the earlier position is inside the search tree
+                if (i > top - ply)
                 {
-                    if (++numRepetitions >= 3)
-                    {
-                        return true;
-                    }
+                    return true;
+                }
+                if (++numRepetitions >= 3)
+                {
+                    return true;
                 }
             }
         }
@@ -82,9 +143,88 @@ private:
 
     const int MAX_DEPTH = 100;
 
-    int nodesSearched = 0;
-    int nodesEvaluated = 0;
-    int transpositionHits = 0;
+    /*
+     * getting checkmated at a certain ply from the root scores MIN_EVAL plus that ply,
+     * so the engine prefers faster mates and slower losses.
+     * return true if the score means one of the sides is getting checkmated
+     */
+    inline bool isMateScore(int score)
+    {
+        return std::abs(score) >= MAX_EVAL - MAX_PLY;
+    }
+
+    /*
+     * the same position can be reached at different plies from the root, so mate scores
+     * are saved to the transposition table as the distance to mate from the node itself,
+     * and turned back into the distance from the root when they are read
+     */
+    inline int scoreToTable(int score, int ply)
+    {
+        if (isMateScore(score))
+        {
+            return score > 0 ? score + ply : score - ply;
+        }
+        return score;
+    }
+    inline int scoreFromTable(int score, int ply)
+    {
+        if (isMateScore(score))
+        {
+            return score > 0 ? score - ply : score + ply;
+        }
+        return score;
+    }
+
+    long long nodesSearched = 0;
+    long long nodesEvaluated = 0;
+    long long transpositionHits = 0;
+    // to measure move ordering, count how many beta cutoffs were caused by the first move searched
+    long long betaCutoffs = 0;
+    long long firstMoveCutoffs = 0;
+
+    // the number of threads that search the position, including the main thread
+    int numThreads = 1;
+
+    /*
+     * set when the search must stop. the main search owns the flag,
+     * and the helper searches refer to the flag of the main search
+     */
+    std::atomic<bool> stopFlag;
+    std::atomic<bool>& stopped;
+
+    // decides how long we are allowed to search for
+    TimeManager timeManager;
+
+    // the score of the best move found by the last call to iterate()
+    int rootScore = 0;
+    // true while the first iteration is searched, which is never cut short by the clock
+    bool isFirstIteration = false;
+
+    // reading the clock is slow, so we only check it once every this many nodes
+    const int TIME_CHECK_NODES = 1024;
+
+    /*
+     * return true if the search must stop. stop the search if we ran out of time.
+     * this is checked at every node, so a deep subtree can not overrun the time limit
+     */
+    inline bool isStopping()
+    {
+        if (!isFirstIteration && nodesSearched % TIME_CHECK_NODES == 0 && timeManager.isHardLimitReached())
+        {
+            stopped = true;
+        }
+        return stopped;
+    }
+
+    // run the iterative deepening loop on all the threads, with the time manager already started
+    Move deepen(int maxDepth);
+
+    /*
+     * the loop run by a helper thread. each helper runs its own iterative
+     * deepening loop, and half of them start one ply deeper than the main thread
+     * so the threads fill the shared transposition table with different subtrees
+     */
+    void helperSearch(int threadId, int maxDepth);
 
     /*
      * depth first negamax search with alpha beta pruning.
@@ -93,90 +233,367 @@ private:
      * https://www.chessprogramming.org/Negamax
      * https://www.chessprogramming.org/Minimax
      * https://www.chessprogramming.org/Alpha-Beta
+     *
+     * if a move is excluded, it is skipped, and the result is not saved to the transposition table
      */
-    int negamax(int depth, int alpha, int beta);
+    int negamax(int depth, int ply, int alpha, int beta, bool isNullMoveAllowed = true, Move excludedMove = NULL_MOVE);
+
+    // the greatest number of plies from the root we keep track of
+    static const int MAX_PLY = 128;
+
+    // two quiet moves per ply that recently caused a beta cutoff
+    Move killers[MAX_PLY][2];
 
     /*
-     * iterative deepening search.
-     * we search the tree depth first repeatedly, starting at depth 1
-     * and increasing, until a time given time restraint has been breached
-     * https://www.chessprogramming.org/Iterative_Deepening
+     * a score for every quiet move, indexed by side to move, square from and square to.
+     * it is increased every time the move causes a beta cutoff
+     */
+    int history[2][64][64];
+    // when a history score grows beyond this limit, the whole table is halved
+    const int HISTORY_LIMIT = 1 << 20;
+    // the move made at each ply from the root, or NULL_MOVE if we passed the turn
+    Move moveStack[MAX_PLY];
+    /*
+     * the index in the repetitions stack of the position right after the last null move on the
+     * search path, or zero if there is none. a null move is not a real move, so a position before
+     * it never really happened on the way to the positions after it, and can not be repeated by them
      */
-    Move iterate(int depth, int startTime, int maxElapsed);
+    int nullMoveIndex = 0;
 
     /*
-     * swap the best move in the move list that occurs after the given index
-     * with the move found at the given index. used for move ordering as an
-     * alpha beta search optimization. it orders moves based on difference
-     * between the score of material captured and material captured with.
-     * this function returns true while there is still a move to be selected
-     *
-     * the sorting works like this:
-     * 1) best move last time we searched this node
-     * 2) winning captures (PxQ)
-     * 3) losing captures (QxP)
-     * 4) quiet moves
+     * a quiet move that refuted each move, indexed by the piece moved
+     * and the square it moved to. many moves have a natural response
+     * https://www.chessprogramming.org/Countermove_Heuristic
+     */
+    Move counterMoves[NONE][64];
+
+    /*
+     * like the history table, but indexed by the piece moved and the square it moved to
+     * of both the previous move and the current move. this remembers which quiet moves
+     * are good as a response to a certain move, instead of in general.
+     * it is too big to live inside the search object, so it is indexed by getContinuationHistory()
+     * https://www.chessprogramming.org/History_Heuristic#Continuation_History
      */
-    inline bool selectMove(Move previousBest, std::vector<Move>& moveList, int index)
+    std::vector<int> continuationHistory;
+
+    // halve every history score, so old cutoffs matter less than new ones
+    void ageHistory();
+
+    /*
+     * a triangular array of principal variations. the principal variation found at a certain ply
+     * is saved in the row of that ply, starting at the column of that ply. when a move raises alpha,
+     * the principal variation of its node is the move followed by the principal variation of the child.
+     * pvLength holds the column where each row ends
+     * https://www.chessprogramming.org/Triangular_PV-Table
+     */
+    Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+
+    // the principal variation of the last completed iteration
+    std::vector<Move> principalVariation;
+
+    // the number of lines searched in multi pv mode
+    int numLines = 1;
+    // the lines of the last completed iteration
+    std::vector<AnalysisLine> analysisLines;
+    // root moves that already belong to a line in the current iteration
+    std::vector<Move> excludedRootMoves;
+
+    // a legal move at the root, with what we learned about it in the last iteration that searched it
+    struct RootMove
     {
-        if (index >= moveList.size())
+        Move move;
+        int score; // the score, or a bound on the score, of the move
+        long long nodes; // the number of nodes in the subtree of the move
+    };
+    // the root moves, kept for the whole search and reordered between iterations
+    std::vector<RootMove> rootMoves;
+
+    // move the given root move to the front of the root moves, keeping the order of the others
+    inline void moveToFront(Move move)
+    {
+        for (int i = 0; i < rootMoves.size(); i++)
         {
-            return false;
+            if (rootMoves[i].move == move)
+            {
+                std::rotate(rootMoves.begin(), rootMoves.begin() + i, rootMoves.begin() + i + 1);
+                return;
+            }
         }
-        Move move = moveList[index];
-        PieceType pieceCaptured = getPieceCaptured(move);
+    }
 
-        int bestIndex = index;
-        int bestScore;
-        if (move == previousBest)
+    // the greatest ply reached during the current iteration, including the quiescence search
+    int selectiveDepth = 0;
+
+    // start an empty principal variation for the node at the given ply
+    inline void startPrincipalVariation(int ply)
+    {
+        selectiveDepth = std::max(selectiveDepth, ply);
+        if (ply < MAX_PLY)
         {
-            bestScore = 3 * PIECE_SCORES[ENGINE_QUEEN];
+            pvLength[ply] = ply;
         }
-        else if (pieceCaptured != NONE)
+    }
+
+    // the given move raised alpha, so it starts the principal variation at the given ply
+    inline void updatePrincipalVariation(int ply, Move move)
+    {
+        if (ply + 1 < MAX_PLY)
         {
-            // sort winning captures before losing captures (PxQ before QxP),
-            // the score will always be at least the value of a pawn
-            bestScore = PIECE_SCORES[ENGINE_QUEEN] +
-                        PIECE_SCORES[pieceCaptured] -
-                        PIECE_SCORES[getPieceMoved(move)];
+            pvTable[ply][ply] = move;
+            for (int next = ply + 1; next < pvLength[ply + 1]; next++)
+            {
+                pvTable[ply][next] = pvTable[ply + 1][next];
+            }
+            pvLength[ply] = std::max(pvLength[ply + 1], ply + 1);
         }
-        else
+    }
+
+    // return true if every move from the root to the given ply follows the last principal variation
+    inline bool isOnPrincipalVariation(int ply)
+    {
+        if (ply >= principalVariation.size() || ply > MAX_PLY)
         {
-            bestScore = -1;
+            return false;
         }
-        // find the index of the best capture after the given index
-        for (int i = index + 1; i < moveList.size(); i++)
+        for (int i = 0; i < ply; i++)
         {
-            move = moveList[i];
-            pieceCaptured = getPieceCaptured(move);
+            if (moveStack[i] != principalVariation[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // print the depth, score, nodes and principal variation of a completed iteration
+    void reportIteration(int depth);
+
+    /*
+     * return the move that led to the node at the given ply, or NULL_MOVE if there is none.
+     * quiescence search scores its moves at ply MAX_PLY to say it has no killers,
+     * so that ply has no previous move either, whatever is left over on the stack
+     */
+    inline Move getPreviousMove(int ply)
+    {
+        return ply > 0 && ply < MAX_PLY ? moveStack[ply - 1] : NULL_MOVE;
+    }
+
+    // the continuation history score of a move played in response to the previous move
+    inline int& getContinuationHistory(Move previousMove, Move move)
+    {
+        return continuationHistory[
+            ((getPieceMoved(previousMove) * 64 + getSquareTo(previousMove)) * NONE +
+            getPieceMoved(move)) * 64 + getSquareTo(move)];
+    }
+
+    // reverse futility pruning is only tried with at most this much depth left
+    const int REVERSE_FUTILITY_DEPTH = 6;
+    // the static evaluation has to beat beta by this much per ply of depth left
+    const int REVERSE_FUTILITY_MARGIN = PIECE_SCORES[ENGINE_PAWN];
+
+    // razoring is only tried with at most this much depth left
+    const int RAZOR_DEPTH = 3;
+    // the static evaluation has to be this far below alpha per ply of depth left
+    const int RAZOR_MARGIN = PIECE_SCORES[ENGINE_PAWN] * 2;
+
+    // futility pruning is only tried with at most this much depth left
+    const int FUTILITY_DEPTH = 2;
+    // how much a quiet move could gain in positional score per ply of depth left
+    const int FUTILITY_MARGIN = PIECE_SCORES[ENGINE_PAWN] * 3 / 2;
+
+    // late move pruning is only tried with at most this much depth left
+    const int LATE_MOVE_PRUNING_DEPTH = 3;
+    // search this many moves plus the depth squared before pruning late quiet moves
+    const int LATE_MOVE_PRUNING_INDEX = 3;
+
+    // the number of plies we extended the search by on the path from the root to the current node
+    int pathExtensions = 0;
+    // the depth of the current iterative deepening iteration
+    int rootDepth = 1;
+    // every path from the root may be extended by one ply for every this many plies of root depth
+    const int EXTENSION_DEPTH = 4;
 
-            int score;
-            if (move == previousBest)
+    // singular extensions are only tried with at least this much depth left
+    const int SINGULAR_DEPTH = 6;
+    // every other move has to be this much worse than the best move per ply of depth left
+    const int SINGULAR_MARGIN = 2;
+
+    // what to do at nodes without a best move from the transposition table
+    InternalIteration internalIteration = INTERNAL_REDUCTIONS;
+    // internal iterative deepening or reductions are only done with at least this much depth left
+    const int INTERNAL_ITERATION_DEPTH = 4;
+    // internal iterative deepening searches this many plies less deeply to find a best move
+    const int INTERNAL_DEEPENING_REDUCTION = 2;
+
+    // null move pruning is only tried with at least this much depth left
+    const int NULL_MOVE_DEPTH = 3;
+    // verify null move cutoffs when the side to move has at most this many pieces other than pawns
+    const int NULL_MOVE_VERIFY_PIECES = 2;
+
+    // late move reductions are only done with at least this much depth left
+    const int LATE_MOVE_DEPTH = 3;
+    // this many moves are always searched to full depth before we start reducing
+    const int LATE_MOVE_INDEX = 3;
+    // how many plies to reduce a late move by, indexed by depth and move index
+    int lateMoveReductions[64][64];
+    void initLateMoveReductions();
+    // fill the reduction table and clear the move ordering tables, for both constructors
+    void init();
+
+    /*
+     * capture-only search at the leaves of the negamax tree.
+     * it searches captures until there are none left worth searching,
+     * so we never statically evaluate a position in the middle of an exchange
+     */
+    int quiesce(int ply, int alpha, int beta);
+
+    // a capture must be able to bring the score this close to alpha to be searched in quiescence
+    const int DELTA_MARGIN = PIECE_SCORES[ENGINE_PAWN] * 2;
+
+    /*
+     * iterative deepening search.
+     * we search the tree depth first repeatedly, starting at depth 1
+     * and increasing, until a time given time restraint has been breached.
+     * the best move from the previous iteration is searched first. if we run out
+     * of time in the middle of an iteration, the best move among the root moves
+     * that were fully searched is returned, or NULL_MOVE if there are none
+     * https://www.chessprogramming.org/Iterative_Deepening
+     */
+    Move iterate(int depth, Move previousBest);
+
+    /*
+     * search the root with an aspiration window around the given score, widening it until
+     * the score falls inside. on success, the score is set to the score of the returned move
+     */
+    Move aspirate(int depth, Move previousBest, int& score);
+
+    // the first aspiration window is this wide on each side of the last score
+    const int ASPIRATION_WINDOW = PIECE_SCORES[ENGINE_PAWN] / 4;
+
+    /*
+     * search every root move within the given window, except the excluded root moves.
+     * the root keeps raising alpha like any other node. the best move is only set by a move
+     * that raised alpha. returns the best score found
+     */
+    int searchRoot(int depth, int alpha, int beta, Move previousBest, Move& bestMove);
+
+    /*
+     * static exchange evaluation. play out every capture on the destination square of the
+     * given capture, always capturing with the least valuable piece, and let each side
+     * stop capturing when it is ahead. returns the material the side to move wins,
+     * or a negative number if the capture loses material
+     * https://www.chessprogramming.org/Static_Exchange_Evaluation
+     * https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+     */
+    int staticExchange(Move move);
+
+    // the king is worth nothing in the evaluation, but it can never be captured in an exchange
+    inline int getExchangeScore(PieceType piece)
+    {
+        return piece == ENGINE_KING || piece == PLAYER_KING ? MAX_EVAL / 2 : PIECE_SCORES[piece];
+    }
+
+    // killer moves are ordered right after good captures, and counter moves right after killer moves
+    const int KILLER_SCORE = PIECE_SCORES[ENGINE_PAWN] - 1;
+    const int COUNTER_MOVE_SCORE = KILLER_SCORE - 2;
+    // captures that lose material are ordered after all quiet moves
+    const int BAD_CAPTURE_SCORE = -3 * HISTORY_LIMIT;
+
+    /*
+     * score a move for move ordering. the moves are ordered like this:
+     * 1) best move last time we searched this node
+     * 2) captures that do not lose material, most valuable victim first (PxQ before QxP)
+     * 3) killer moves
+     * 4) the counter move to the previous move
+     * 5) quiet moves, ordered by their history score plus their continuation history score
+     * 6) captures that lose material, least loss first
+     */
+    inline int scoreMove(Move move, Move previousBest, int ply)
+    {
+        if (move == previousBest)
+        {
+            return 3 * PIECE_SCORES[ENGINE_QUEEN];
+        }
+        PieceType pieceCaptured = getPieceCaptured(move);
+        if (pieceCaptured != NONE)
+        {
+            // capturing a piece at least as valuable as our own piece can never lose material
+            int exchange = PIECE_SCORES[pieceCaptured] >= PIECE_SCORES[getPieceMoved(move)]
+                ? 0
+                : staticExchange(move);
+            if (exchange < 0)
             {
-                score = 3 * PIECE_SCORES[ENGINE_QUEEN];
+                return BAD_CAPTURE_SCORE + exchange;
             }
-            else if (pieceCaptured != NONE)
+            // the score will always be at least the value of a pawn
+            return PIECE_SCORES[ENGINE_QUEEN] +
+                   PIECE_SCORES[pieceCaptured] -
+                   PIECE_SCORES[getPieceMoved(move)];
+        }
+        if (ply < MAX_PLY)
+        {
+            if (move == killers[ply][0])
+            {
+                return KILLER_SCORE;
+            }
+            if (move == killers[ply][1])
             {
-                score = PIECE_SCORES[ENGINE_QUEEN] +
-                            PIECE_SCORES[pieceCaptured] -
-                            PIECE_SCORES[getPieceMoved(move)];
+                return KILLER_SCORE - 1;
             }
-            else
+        }
+        int score = history[getPieceMoved(move) >= ENGINE_PAWN][getSquareFrom(move)][getSquareTo(move)];
+        Move previousMove = getPreviousMove(ply);
+        if (previousMove != NULL_MOVE)
+        {
+            if (move == counterMoves[getPieceMoved(previousMove)][getSquareTo(previousMove)])
             {
-                score = -1;
+                return COUNTER_MOVE_SCORE;
             }
+            score += getContinuationHistory(previousMove, move);
+        }
+        // history scores are never negative, so this is always less than a counter move score
+        return score - 2 * HISTORY_LIMIT - 1;
+    }
 
-            if (score > bestScore)
+    /*
+     * score every move in the move list once, before the moves are selected.
+     * static exchange evaluation is too slow to score the moves every time we select one
+     */
+    inline void scoreMoves(Move previousBest, std::vector<Move>& moveList, std::vector<int>& moveScores, int ply)
+    {
+        moveScores.resize(moveList.size());
+        for (int i = 0; i < moveList.size(); i++)
+        {
+            moveScores[i] = scoreMove(moveList[i], previousBest, ply);
+        }
+    }
+
+    /*
+     * swap the best move in the move list that occurs after the given index
+     * with the move found at the given index. used for move ordering as an
+     * alpha beta search optimization. the moves are scored by scoreMoves().
+     * this function returns true while there is still a move to be selected
+     */
+    inline bool selectMove(std::vector<Move>& moveList, std::vector<int>& moveScores, int index)
+    {
+        if (index >= moveList.size())
+        {
+            return false;
+        }
+        int bestIndex = index;
+        // find the index of the best move after the given index
+        for (int i = index + 1; i < moveList.size(); i++)
+        {
+            if (moveScores[i] > moveScores[bestIndex])
             {
-                bestScore = score;
                 bestIndex = i;
             }
         }
         // we found the index of the strongest move.
         // swap the best move with the index we started with
-        move = moveList[bestIndex];
-        moveList[bestIndex] = moveList[index];
-        moveList[index] = move;
+        std::swap(moveList[bestIndex], moveList[index]);
+        std::swap(moveScores[bestIndex], moveScores[index]);
 
         return true;
     }
@@ -16,14 +16,14 @@ void Tests::tacticSuite()
     assert(getSquareTo(runGetBestMove(FORK_1, 100)) == E2);
     assert(getSquareTo(runGetBestMove(FORK_2, 100)) == D3);
     assert(getSquareTo(runGetBestMove(FORK_3, 100)) == C2);
-    assert(getSquareTo(runGetBestMove(FORK_4, 1000)) == E1);
+    assert(getSquareTo(runGetBestMove(FORK_4, 500)) == E1);
     assert(getSquareTo(runGetBestMove(FORK_5, 100)) == E4);
 
     // pin tactics winning material
     assert(getSquareTo(runGetBestMove(PIN_1, 100)) == F5);
     assert(getSquareTo(runGetBestMove(PIN_2, 100)) == E8);
-    assert(getSquareTo(runGetBestMove(PIN_3, 1000)) == E8);
-    assert(getSquareTo(runGetBestMove(PIN_4, 1000)) == G7);
+    assert(getSquareTo(runGetBestMove(PIN_3, 500)) == E8);
+    assert(getSquareTo(runGetBestMove(PIN_4, 500)) == G7);
     assert(getSquareTo(runGetBestMove(PIN_5, 100)) == C6);
 
     // skewer tactics winning material
@@ -31,13 +31,13 @@ void Tests::tacticSuite()
     assert(getSquareTo(runGetBestMove(SKEWER_2, 100)) == F6);
     assert(getSquareTo(runGetBestMove(SKEWER_3, 100)) == E8);
     assert(getSquareTo(runGetBestMove(SKEWER_4, 100)) == B6);
-    assert(getSquareTo(runGetBestMove(SKEWER_5, 1000)) == C5);
+    assert(getSquareTo(runGetBestMove(SKEWER_5, 500)) == C5);
 
     // tactics relying on checkmates to win material
-    assert(getSquareTo(runGetBestMove(MATE_TACTIC_1, 1000)) == E7);
-    assert(getSquareTo(runGetBestMove(MATE_TACTIC_2, 1000)) == G8);
+    assert(getSquareTo(runGetBestMove(MATE_TACTIC_1, 500)) == E7);
+    assert(getSquareTo(runGetBestMove(MATE_TACTIC_2, 500)) == G8);
     assert(getSquareTo(runGetBestMove(MATE_TACTIC_3, 100)) == C1);
-    assert(getSquareTo(runGetBestMove(MATE_TACTIC_4, 1000)) == E8);
+    assert(getSquareTo(runGetBestMove(MATE_TACTIC_4, 500)) == E8);
     assert(getSquareTo(runGetBestMove(MATE_TACTIC_5, 100)) == G5);
 
     // make sure the engine desperately prolongs mate
@@ -52,10 +52,10 @@ void Tests::tacticSuite()
     assert(getSquareTo(runGetBestMove(MATE_4, 100)) == E1);
     assert(getSquareTo(runGetBestMove(MATE_5, 100)) == G1);
     assert(getSquareTo(runGetBestMove(MATE_6, 100)) == C3);
-    assert(getSquareTo(runGetBestMove(MATE_7, 1000)) == H2);
+    assert(getSquareTo(runGetBestMove(MATE_7, 500)) == H2);
     assert(getSquareTo(runGetBestMove(MATE_8, 100)) == F3);
-    assert(getSquareTo(runGetBestMove(MATE_9, 2000)) == F3);
-    assert(getSquareTo(runGetBestMove(MATE_10, 1000)) == C2);
+    assert(getSquareTo(runGetBestMove(MATE_9, 500)) == F3);
+    assert(getSquareTo(runGetBestMove(MATE_10, 500)) == C2);
 
     std::cout << "* tactical suite run terminated.\n";
 }
@@ -115,6 +115,155 @@ void Tests::perftSuite()
 
 }
 
+void Tests::smpSuite()
+{
+    std::cout << "* smp suite run initialized\n";
+    const std::string positions[] = {
+        FORK_1, FORK_4, PIN_3, PIN_4, SKEWER_5,
+        MATE_TACTIC_1, MATE_TACTIC_4, MATE_7, MATE_9, MATE_10
+    };
+    // more threads than cores only share the same cores, so those numbers say nothing about scaling
+    int cores = (int)std::thread::hardware_concurrency();
+    std::cout << "* cores available ---> " << cores << std::endl;
+    double singleThreadElapsed = 0;
+    for (int threads = 1; threads <= 16; threads *= 2)
+    {
+        long long nodes = 0;
+        double elapsed = 0;
+        for (const std::string& fen : positions)
+        {
+            Position smpPosition(fen);
+            Search smpSearch(smpPosition);
+            smpSearch.setThreads(threads);
+
+            auto start = std::chrono::steady_clock::now();
+            smpSearch.getBestMove(INT_MAX, SMP_DEPTH);
+            elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            nodes += smpSearch.getNodesSearched();
+        }
+        std::cout << "* threads " << threads << ":\n";
+        std::cout << "*\t seconds to depth " << SMP_DEPTH << " ---> " << elapsed << std::endl;
+        std::cout << "*\t nodes searched     ---> " << nodes << std::endl;
+        std::cout << "*\t nodes per second   ---> " << (long long)(nodes / elapsed) << std::endl;
+        if (threads == 1)
+        {
+            singleThreadElapsed = elapsed;
+        }
+        std::cout << "*\t speedup            ---> " << singleThreadElapsed / elapsed << std::endl;
+        if (threads > cores)
+        {
+            std::cout << "*\t more threads than cores, this is not a measure of scaling\n";
+        }
+    }
+    std::cout << "* smp suite run terminated.\n";
+}
+
+void Tests::nodeSuite()
+{
+    std::cout << "* node suite run initialized\n";
+    const std::string positions[] = {
+        FORK_1, FORK_2, FORK_3, FORK_4, FORK_5,
+        PIN_1, PIN_2, PIN_3, PIN_4, PIN_5,
+        SKEWER_1, SKEWER_2, SKEWER_3, SKEWER_4, SKEWER_5,
+        MATE_TACTIC_1, MATE_TACTIC_2, MATE_TACTIC_3, MATE_TACTIC_4, MATE_TACTIC_5,
+        MATE_1, MATE_4, MATE_7, MATE_9, MATE_10,
+        toEngineMove(POS_1), toEngineMove(POS_2), toEngineMove(POS_3),
+        toEngineMove(POS_5), toEngineMove(POS_6)
+    };
+    // compare the ways of searching nodes without a best move in the transposition table
+    const InternalIteration modes[] = {INTERNAL_DEEPENING, INTERNAL_REDUCTIONS};
+    const std::string modeNames[] = {"internal iterative deepening", "internal iterative reductions"};
+    for (int mode = 0; mode < 2; mode++)
+    {
+        std::cout << "* searching with " << modeNames[mode] << std::endl;
+        long long totalNodes = 0;
+        for (const std::string& fen : positions)
+        {
+            Position nodePosition(fen);
+            Search nodeSearch(nodePosition);
+            nodeSearch.setInternalIteration(modes[mode]);
+
+            Move bestMove = nodeSearch.getBestMove(INT_MAX, NODE_DEPTH);
+            std::cout << "* position FEN: \"" << fen << "\"\n";
+            std::cout << "*\t move found     ---> " << moves::toNotation(bestMove) << std::endl;
+            std::cout << "*\t nodes searched ---> " << nodeSearch.getNodesSearched() << std::endl;
+            totalNodes += nodeSearch.getNodesSearched();
+        }
+        std::cout << "* total nodes searched to depth " << NODE_DEPTH << " with " << modeNames[mode] << ": " << totalNodes << std::endl;
+    }
+    std::cout << "* node suite run terminated.\n";
+}
+
+void Tests::hashSuite()
+{
+    std::cout << "* hash suite run initialized\n";
+    const std::string positions[] = {POS_1, POS_2, POS_3, POS_4, POS_5, POS_6};
+    for (const std::string& fen : positions)
+    {
+        // a megabyte is far too small for the trees, so the threads are always fighting over the same slots
+        TranspositionTable table(1);
+        std::vector<long long> numFound(HASH_THREADS, 0);
+        std::vector<std::thread> threads;
+        for (int threadId = 0; threadId < HASH_THREADS; threadId++)
+        {
+            threads.push_back(std::thread([&table, &numFound, fen, threadId, this]()
+            {
+                Position walkPosition(fen);
+                MoveGen walkMoveGen(walkPosition);
+                walkTable(walkPosition, walkMoveGen, table, HASH_DEPTH, threadId, numFound[threadId]);
+            }));
+        }
+        long long totalFound = 0;
+        for (int threadId = 0; threadId < HASH_THREADS; threadId++)
+        {
+            threads[threadId].join();
+            totalFound += numFound[threadId];
+        }
+        std::cout << "* position FEN: \"" << fen << "\"\n";
+        std::cout << "*\t entries found ---> " << totalFound << std::endl;
+    }
+
+    // a table loaded from a file must find exactly what the table that saved it would have found
+    std::cout << "* saving and loading a table for position FEN: \"" << POS_2 << "\"\n";
+    const std::string path = "hash_suite.tt";
+    Position filePosition(POS_2);
+    MoveGen fileMoveGen(filePosition);
+    TranspositionTable savedTable(1);
+    long long numSaved = 0;
+    walkTable(filePosition, fileMoveGen, savedTable, HASH_DEPTH, 0, numSaved);
+    assert(savedTable.saveFile(path));
+    TranspositionTable loadedTable(2);
+    assert(loadedTable.loadFile(path));
+    assert(loadedTable.getMegabytes() == 1);
+    long long numFound = 0;
+    long long numLoaded = 0;
+    walkTable(filePosition, fileMoveGen, savedTable, HASH_DEPTH, 0, numFound);
+    walkTable(filePosition, fileMoveGen, loadedTable, HASH_DEPTH, 0, numLoaded);
+    std::cout << "*\t entries found after saving  ---> " << numFound << std::endl;
+    std::cout << "*\t entries found after loading ---> " << numLoaded << std::endl;
+    assert(numLoaded == numFound);
+
+    // a loaded table is mapped from its file, so saving it back to the same file must not pull the file out from under it
+    assert(loadedTable.saveFile(path));
+    TranspositionTable reloadedTable(2);
+    assert(reloadedTable.loadFile(path));
+    long long numResaved = 0;
+    long long numReloaded = 0;
+    walkTable(filePosition, fileMoveGen, loadedTable, HASH_DEPTH, 0, numResaved);
+    walkTable(filePosition, fileMoveGen, reloadedTable, HASH_DEPTH, 0, numReloaded);
+    std::remove(path.c_str());
+    std::cout << "*\t entries found after saving to the same file ---> " << numResaved << std::endl;
+    std::cout << "*\t entries found after loading it again       ---> " << numReloaded << std::endl;
+    assert(numReloaded == numResaved);
+    std::cout << "* hash suite run terminated.\n";
+}
+
+std::string Tests::toEngineMove(std::string fen)
+{
+    fen[fen.find(" w ") + 1] = 'b';
+    return fen;
+}
+
 Move Tests::runGetBestMove(std::string fen, int maxElapsed)
 {
     std::cout << "* running tactical test for position FEN: \"" << fen << "\"\n";
@@ -200,4 +349,62 @@ void Tests::perft(int depth, int& numLeafNodes)
             position->unMakeMove<true>(move, rights);
         }
     }
-}
\ No newline at end of file
+}
+
+void Tests::walkTable(Position& walkPosition, MoveGen& walkMoveGen, TranspositionTable& table,
+                      int depth, int threadId, long long& numFound)
+{
+    if (walkPosition.isEngineMove)
+    {
+        walkMoveGen.genEngineMoves();
+    }
+    else
+    {
+        walkMoveGen.genPlayerMoves();
+    }
+    std::vector<Move> moveList = walkMoveGen.moveList;
+    if (moveList.empty())
+    {
+        return;
+    }
+
+    Zobrist hash = walkPosition.hash;
+    Move bestMove = moveList[hash % moveList.size()];
+    int evaluation = (int16_t)(hash >> 48);
+    int entryDepth = (int)((hash >> 40) & 63);
+    Bound bound = (Bound)(UPPER_BOUND + (hash >> 32) % 3);
+
+    TranspositionTable::Entry entry;
+    if (table.probe(hash, entry))
+    {
+        numFound++;
+        assert(entry.bestMove == bestMove);
+        assert(entry.evaluation == evaluation);
+        assert(entry.depth == entryDepth);
+        assert(entry.getBound() == bound);
+    }
+    table.save(hash, bestMove, evaluation, entryDepth, bound);
+
+    if (depth == 0)
+    {
+        return;
+    }
+    // every thread walks the moves in a different order, so they reach the same positions at different times
+    for (int i = 0; i < (int)moveList.size(); i++)
+    {
+        Move move = moveList[(i + threadId) % moveList.size()];
+        PositionRights rights = walkPosition.rights;
+        if (walkPosition.isEngineMove)
+        {
+            walkPosition.makeMove<true>(move);
+            walkTable(walkPosition, walkMoveGen, table, depth - 1, threadId, numFound);
+            walkPosition.unMakeMove<true>(move, rights);
+        }
+        else
+        {
+            walkPosition.makeMove<false>(move);
+            walkTable(walkPosition, walkMoveGen, table, depth - 1, threadId, numFound);
+            walkPosition.unMakeMove<false>(move, rights);
+        }
+    }
+}
@@ -7,6 +7,8 @@
 
 #include <iostream>
 #include <ctime>
+#include <climits>
+#include <cstdio>
 #include "Search.h"
 
 class Tests
@@ -18,6 +20,17 @@ public:
     void perftSuite();
     // test suite with basic tactical puzzles for the engine to solve
     void tacticSuite();
+    // benchmark of time to depth and nodes per second for 1, 2, 4, 8 and 16 search threads
+    void smpSuite();
+    // benchmark of nodes searched to a fixed depth, for measuring search improvements.
+    // it runs once with internal iterative deepening and once with internal iterative reductions
+    void nodeSuite();
+    /*
+     * stress test of the lockless transposition table. many threads walk the trees of the perft
+     * positions at the same time, and they all share one tiny table, so they overwrite each other constantly.
+     * it also makes sure a table saved to a file comes back exactly the same
+     */
+    void hashSuite();
 
 private:
     Position* position;
@@ -131,9 +144,32 @@ private:
      * ENGINE_IS_WHITE must be false for the perft test positions
      */
     int runPerft(int depth, std::string fen);
+    // the depth every tactical position is searched to during the smp benchmark
+    const int SMP_DEPTH = 6;
+    // the depth every position is searched to during the node benchmark
+    const int NODE_DEPTH = 5;
+
+    /*
+     * the perft positions are all the player's turn, but the engine can only search
+     * positions where it is the engine's turn. this gives the same position with black to move.
+     * position 4 is left out of the node benchmark, because black would be able to capture the white king
+     */
+    std::string toEngineMove(std::string fen);
     // recursively find the number of leaf positions that exist at a given depth
     void perft(int depth, int& numLeaves);
 
+    // the number of threads sharing the table during the hash suite
+    const int HASH_THREADS = 8;
+    // the depth every perft position is walked to during the hash suite
+    const int HASH_DEPTH = 3;
+    /*
+     * recursively walk the tree of a position, saving an entry for every node to the table.
+     * every part of the entry is made from the hash of its position, so an entry found
+     * in the table must agree with the position it was found for. a torn entry would not
+     */
+    static void walkTable(Position& walkPosition, MoveGen& walkMoveGen, TranspositionTable& table,
+                          int depth, int threadId, long long& numFound);
+
 
 };
 
@@ -0,0 +1,84 @@
+//
+// Created by Joe Chrisman on 10/17/22.
+//
+
+#include "TimeManager.h"
+
+TimeManager::TimeManager()
+{
+    startMove(0);
+}
+
+void TimeManager::startMove(int moveTime)
+{
+    startTime = std::chrono::steady_clock::now();
+    softLimit = moveTime;
+    hardLimit = moveTime;
+    isAdaptive = false;
+    lastBestMove = NULL_MOVE;
+    lastScore = 0;
+    stableIterations = 0;
+}
+
+void TimeManager::startMove(GameClock clock)
+{
+    startMove(0);
+    isAdaptive = true;
+
+    // never plan to use the time we need to actually play the move
+    int available = std::max(clock.timeLeft - MOVE_OVERHEAD, 1);
+    int movesToGo = clock.movesToGo > 0 ? clock.movesToGo : EXPECTED_MOVES_TO_GO;
+
+    // spend an equal share of the clock on every move, plus most of the increment
+    softLimit = available / movesToGo + clock.increment * 3 / 4;
+    // but never plan to spend more than half of the clock on one move
+    softLimit = std::min(softLimit, available / 2);
+    /*
+     * with almost nothing left on the clock both limits would round down to zero,
+     * and the engine would play the first move its first iteration liked.
+     * a few milliseconds are enough for a couple more iterations
+     */
+    if (softLimit < MINIMUM_THINKING_TIME)
+    {
+        softLimit = MINIMUM_THINKING_TIME;
+    }
+    // and never go over three quarters of the clock, even when the search is in trouble
+    hardLimit = std::min(softLimit * HARD_LIMIT_FACTOR, available * 3 / 4);
+    hardLimit = std::max(hardLimit, softLimit);
+}
+
+bool TimeManager::isSoftLimitReached(Move bestMove, int score)
+{
+    int elapsed = getElapsed();
+    if (!isAdaptive)
+    {
+        return elapsed > hardLimit;
+    }
+
+    if (bestMove == lastBestMove)
+    {
+        stableIterations++;
+    }
+    else
+    {
+        stableIterations = 0;
+    }
+
+    /*
+     * if the best move keeps coming out on top, it is unlikely to change in the next iteration,
+     * so we are happy to stop early. after four stable iterations we only use half the soft limit
+     */
+    int scaledLimit = softLimit * (8 - std::min(stableIterations, 4)) / 8;
+    /*
+     * if the score dropped since the last iteration, the search just found a problem
+     * with the move it liked. take more time so it can find a way out
+     */
+    if (lastBestMove != NULL_MOVE && score < lastScore - SCORE_DROP)
+    {
+        scaledLimit = softLimit * 2;
+    }
+    lastBestMove = bestMove;
+    lastScore = score;
+
+    return elapsed > std::min(scaledLimit, hardLimit);
+}
@@ -0,0 +1,82 @@
+//
+// Created by Joe Chrisman on 10/17/22.
+//
+
+#ifndef DEEPENING1_TIMEMANAGER_H
+#define DEEPENING1_TIMEMANAGER_H
+
+#include <algorithm>
+#include <chrono>
+#include "Moves.h"
+
+// the state of the clock of the side to move
+struct GameClock
+{
+    int timeLeft; // milliseconds left on the clock
+    int increment; // milliseconds added to the clock after every move
+    int movesToGo; // moves left until the next time control, or zero for sudden death
+};
+
+/*
+ * decides how long the engine is allowed to think about a move.
+ * there are two limits. the soft limit is checked between iterations,
+ * and it is stretched or shrunk depending on how the search is going.
+ * the hard limit is checked inside the search, and it is never exceeded.
+ * https://www.chessprogramming.org/Time_Management
+ */
+class TimeManager
+{
+public:
+    TimeManager();
+
+    // think for exactly this many milliseconds, no matter what happens in the search
+    void startMove(int moveTime);
+    // divide the time left on the clock to decide how long to think
+    void startMove(GameClock clock);
+
+    // wall clock milliseconds elapsed since the move was started
+    inline int getElapsed()
+    {
+        return (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+    }
+
+    // true if the search must stop immediately
+    inline bool isHardLimitReached()
+    {
+        return getElapsed() > hardLimit;
+    }
+
+    /*
+     * called after each completed iteration with its best move and score.
+     * returns true if starting another iteration is a waste of time
+     */
+    bool isSoftLimitReached(Move bestMove, int score);
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+
+    int softLimit;
+    int hardLimit;
+    // false if we were given a fixed time per move
+    bool isAdaptive;
+
+    // the best move and score of the last completed iteration
+    Move lastBestMove;
+    int lastScore;
+    // the number of iterations in a row that agreed on the best move
+    int stableIterations;
+
+    // time we keep on the clock for the overhead of actually playing the move
+    static const int MOVE_OVERHEAD = 50;
+    // how many moves we expect to have to make when the time control has no moves to go
+    static const int EXPECTED_MOVES_TO_GO = 30;
+    // we always plan to think for at least this many milliseconds, however little time is left
+    static const int MINIMUM_THINKING_TIME = 5;
+    // the hard limit is at most this many times the soft limit
+    static const int HARD_LIMIT_FACTOR = 4;
+    // the score has to drop by this much between iterations to think longer
+    static const int SCORE_DROP = 30;
+};
+
+#endif //DEEPENING1_TIMEMANAGER_H
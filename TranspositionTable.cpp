@@ -0,0 +1,357 @@
+//
+// Created by Joe Chrisman on 10/24/22.
+//
+
+#include "TranspositionTable.h"
+#include "Constants.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the first bytes of every table file
+static const char FILE_MAGIC[8] = {'D', 'E', 'E', 'P', 'H', 'A', 'S', 'H'};
+
+/*
+ * mix every zobrist key into one number. a table file only makes sense to an engine
+ * that hashes positions exactly the same way, and the engine hashes pieces by
+ * whether they belong to the engine or the player, so the engine's color matters too
+ */
+static uint64_t getZobristFingerprint()
+{
+    uint64_t fingerprint = ENGINE_IS_WHITE ? 1 : 2;
+    auto mix = [&fingerprint](Zobrist key)
+    {
+        fingerprint = (fingerprint ^ key) * 0x100000001b3;
+    };
+    mix(ENGINE_TO_MOVE_KEY);
+    mix(ENGINE_CASTLE_KINGSIDE_KEY);
+    mix(ENGINE_CASTLE_QUEENSIDE_KEY);
+    mix(PLAYER_CASTLE_KINGSIDE_KEY);
+    mix(PLAYER_CASTLE_QUEENSIDE_KEY);
+    for (Zobrist key : EN_PASSANT_KEYS)
+    {
+        mix(key);
+    }
+    for (int square = 0; square < 64; square++)
+    {
+        for (Zobrist key : SQUARE_PIECE_KEYS[square])
+        {
+            mix(key);
+        }
+    }
+    return fingerprint;
+}
+
+// write all of the given bytes to a file, a chunk at a time
+static bool writeAll(int file, const char* bytes, size_t size, size_t chunk)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(file, bytes, std::min(size, chunk));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+TranspositionTable::TranspositionTable(int megabytes)
+{
+    allocate(megabytes, false);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    release();
+}
+
+void TranspositionTable::resize(int megabytes, bool isHugePages)
+{
+    allocate(megabytes, isHugePages);
+}
+
+int TranspositionTable::getMegabytes()
+{
+    return megabytes;
+}
+
+TranspositionTable::FileHeader TranspositionTable::getFileHeader()
+{
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.slotSize = sizeof(Slot);
+    header.bucketSize = BUCKET_SIZE;
+    header.keyScheme = KEY_SCHEME;
+    header.zobristFingerprint = getZobristFingerprint();
+    header.numBuckets = numBuckets;
+    header.generation = (uint32_t)generation;
+    return header;
+}
+
+bool TranspositionTable::saveFile(const std::string& path)
+{
+    /*
+     * never write over the file in place. the table may have been loaded from the very same file,
+     * and truncating a file that is still mapped makes the next probe of its pages crash.
+     * write a new file next to it and rename it over the old one once it is safely on the disk.
+     * the old mapping keeps the old file alive, and a crash while saving leaves the old file whole
+     */
+    std::string tempPath = path + ".tmp";
+    int file = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+    {
+        return false;
+    }
+    char headerPage[HEADER_SIZE] = {};
+    FileHeader header = getFileHeader();
+    std::memcpy(headerPage, &header, sizeof(header));
+    // the buckets go straight from memory to the file, with no copying and no formatting
+    bool isWritten = writeAll(file, headerPage, HEADER_SIZE, WRITE_CHUNK) &&
+                     writeAll(file, (const char*)buckets, numBuckets * sizeof(Bucket), WRITE_CHUNK) &&
+                     fsync(file) == 0;
+    if (close(file) != 0 || !isWritten || std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TranspositionTable::loadFile(const std::string& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    FileHeader header;
+    FileHeader expected = getFileHeader();
+    struct stat fileStat;
+    bool isCompatible = fstat(file, &fileStat) == 0 &&
+        pread(file, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+        header.version == expected.version &&
+        header.slotSize == expected.slotSize &&
+        header.bucketSize == expected.bucketSize &&
+        header.keyScheme == expected.keyScheme &&
+        header.zobristFingerprint == expected.zobristFingerprint &&
+        /*
+         * the number of buckets comes from the file, so check it by dividing the size of the file
+         * instead of multiplying the number, which could wrap around and make any size look right
+         */
+        fileStat.st_size > (off_t)HEADER_SIZE &&
+        ((uint64_t)fileStat.st_size - HEADER_SIZE) % sizeof(Bucket) == 0 &&
+        ((uint64_t)fileStat.st_size - HEADER_SIZE) / sizeof(Bucket) == header.numBuckets;
+    if (!isCompatible)
+    {
+        close(file);
+        return false;
+    }
+
+    /*
+     * map the file instead of reading it. the pages come in from the disk as the search touches them,
+     * so loading takes the same short time no matter how big the table is. the mapping is private,
+     * so the search writes to its own copy of a page, and the file itself never changes
+     */
+    size_t fileSize = (size_t)fileStat.st_size;
+    void* fileMemory = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (fileMemory == MAP_FAILED)
+    {
+        return false;
+    }
+    release();
+    memory = fileMemory;
+    memorySize = fileSize;
+    buckets = (Bucket*)((char*)memory + HEADER_SIZE);
+    numBuckets = header.numBuckets;
+    megabytes = (int)(numBuckets * sizeof(Bucket) / (1024 * 1024));
+    generation = (int)(header.generation % GENERATIONS);
+    // start reading the whole file in the background, so the search rarely has to wait for the disk
+#ifdef MADV_WILLNEED
+    madvise(memory, memorySize, MADV_WILLNEED);
+#endif
+    return true;
+}
+
+void TranspositionTable::allocate(int megabytes, bool isHugePages)
+{
+    uint64_t newNumBuckets = std::max((uint64_t)megabytes * 1024 * 1024 / sizeof(Bucket), (uint64_t)1);
+    /*
+     * map the memory instead of allocating it, so nothing is written to it up front.
+     * the operating system gives us a zeroed page the first time we touch it, so creating
+     * a search is instant no matter how big the table is, and an empty entry is all zeros.
+     * ask for one huge page more than we need, so the buckets can start on a huge page boundary
+     */
+    size_t newMemorySize = newNumBuckets * sizeof(Bucket) + HUGE_PAGE_SIZE;
+    void* newMemory = mmap(nullptr, newMemorySize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (newMemory == MAP_FAILED)
+    {
+        // the old buckets are still mapped, so the table keeps working at its old size
+        throw std::bad_alloc();
+    }
+    release();
+    this->megabytes = megabytes;
+    numBuckets = newNumBuckets;
+    memory = newMemory;
+    memorySize = newMemorySize;
+    uintptr_t address = (uintptr_t)memory;
+    buckets = (Bucket*)((address + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    generation = 0;
+    if (!isHugePages)
+    {
+        return;
+    }
+    /*
+     * a random probe into a big table misses the TLB almost every time with 4 KB pages.
+     * with 2 MB pages, the page table entries for the whole table have a chance to fit in the TLB.
+     * this is only a hint, and it is only available on linux
+     * https://www.kernel.org/doc/html/latest/admin-guide/mm/transhuge.html
+     */
+#ifdef MADV_HUGEPAGE
+    madvise(buckets, numBuckets * sizeof(Bucket), MADV_HUGEPAGE);
+#endif
+    /*
+     * the first touch of a huge page zeroes all 2 MB of it, and the kernel may have to
+     * compact memory to find one. touch every huge page now, so none of that happens
+     * on the clock of the first search
+     */
+    size_t bucketsSize = numBuckets * sizeof(Bucket);
+    for (size_t offset = 0; offset < bucketsSize; offset += HUGE_PAGE_SIZE)
+    {
+        ((volatile char*)buckets)[offset] = 0;
+    }
+}
+
+void TranspositionTable::release()
+{
+    if (memory)
+    {
+        munmap(memory, memorySize);
+        memory = nullptr;
+        buckets = nullptr;
+    }
+}
+
+void TranspositionTable::newSearch()
+{
+    generation = (generation + 1) % GENERATIONS;
+}
+
+int TranspositionTable::getHashfull()
+{
+    // sample the first thousand entries, they are as good as any others
+    int used = 0;
+    int sampled = 0;
+    for (uint64_t i = 0; i < numBuckets && sampled < 1000; i++)
+    {
+        for (int j = 0; j < BUCKET_SIZE; j++, sampled++)
+        {
+            Entry entry = unpack(buckets[i].slots[j].data.load(std::memory_order_relaxed));
+            if (entry.getBound() != NO_BOUND && entry.getGeneration() == generation)
+            {
+                used++;
+            }
+        }
+    }
+    return used * 1000 / sampled;
+}
+
+bool TranspositionTable::probe(Zobrist hash, Entry& entry)
+{
+    Bucket& bucket = buckets[getIndex(hash)];
+    for (int i = 0; i < BUCKET_SIZE; i++)
+    {
+        Slot& slot = bucket.slots[i];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t key = slot.key.load(std::memory_order_relaxed);
+        if ((key ^ data) == hash && data)
+        {
+            entry = unpack(data);
+            // the entry is still useful to this search, so it should not be replaced as if it were stale
+            if (entry.getGeneration() != generation)
+            {
+                Entry refreshed = entry;
+                refreshed.generationBound = (uint8_t)(generation << 2 | entry.getBound());
+                uint64_t refreshedData = pack(refreshed);
+                slot.key.store(hash ^ refreshedData, std::memory_order_relaxed);
+                slot.data.store(refreshedData, std::memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::save(Zobrist hash, Move bestMove, int evaluation, int depth, Bound bound)
+{
+    Bucket& bucket = buckets[getIndex(hash)];
+
+    /*
+     * if the position is already in the bucket, overwrite it, because the new search
+     * of the position knows more than the old one. otherwise, replace the least useful entry.
+     * deep entries save the most work, and entries from older searches are probably useless
+     * https://www.chessprogramming.org/Transposition_Table#Replacement_Strategies
+     */
+    Slot* replaced = nullptr;
+    int replacedWorth = 0;
+    for (int i = 0; i < BUCKET_SIZE; i++)
+    {
+        Slot& slot = bucket.slots[i];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t key = slot.key.load(std::memory_order_relaxed);
+        Entry entry = unpack(data);
+        if ((key ^ data) == hash && data)
+        {
+            // a search that failed low has no best move, so keep the one we already had
+            if (bestMove == NULL_MOVE)
+            {
+                bestMove = entry.bestMove;
+            }
+            /*
+             * a much shallower bound does not know more than the entry we have, it was probably
+             * written by a reduced search of the node. keep the deep score, but take the new best move
+             */
+            if (bound != EXACT_BOUND && depth + SHALLOW_DEPTH < entry.depth)
+            {
+                entry.bestMove = bestMove;
+                data = pack(entry);
+                slot.key.store(hash ^ data, std::memory_order_relaxed);
+                slot.data.store(data, std::memory_order_relaxed);
+                return;
+            }
+            replaced = &slot;
+            break;
+        }
+        int worth = getWorth(entry);
+        if (!replaced || worth < replacedWorth)
+        {
+            replaced = &slot;
+            replacedWorth = worth;
+        }
+    }
+
+    Entry entry;
+    entry.bestMove = bestMove;
+    entry.evaluation = (int16_t)evaluation;
+    entry.depth = (uint8_t)depth;
+    entry.generationBound = (uint8_t)(generation << 2 | bound);
+    uint64_t data = pack(entry);
+    replaced->key.store(hash ^ data, std::memory_order_relaxed);
+    replaced->data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,226 @@
+//
+// Created by Joe Chrisman on 10/24/22.
+//
+
+#ifndef DEEPENING1_TRANSPOSITIONTABLE_H
+#define DEEPENING1_TRANSPOSITIONTABLE_H
+
+#include "Moves.h"
+#include "Zobrist.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// what the evaluation of an entry tells us about the true score of its position
+enum Bound
+{
+    NO_BOUND, // the entry is empty
+    UPPER_BOUND, // we could not find a move greater than alpha, the evaluation is an upper bound
+    LOWER_BOUND, // we found a move greater than beta, the evaluation is a lower bound
+    EXACT_BOUND // the evaluation for this node does not belong to a bound
+};
+
+/*
+ * a hash table that holds information about previously evaluated nodes.
+ * by remembering what we already calculated, we can prune huge subtrees.
+ * the table is an array of buckets, and every bucket fills exactly one 64 byte cache line,
+ * so looking up a position costs at most one cache miss no matter which entry it is in.
+ * https://www.chessprogramming.org/Transposition_Table
+ */
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(int megabytes);
+    ~TranspositionTable();
+    // the table owns its memory, so it can not be copied
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    /*
+     * throw away the table and allocate an empty one of the given size in megabytes.
+     * if there is not enough memory, std::bad_alloc is thrown and the old table is kept.
+     * with huge pages, the table asks for 2 MB pages and touches all of them right away,
+     * which is worth it for a long running game, but not for a short lived search.
+     * no search may be using the table while it is resized
+     */
+    void resize(int megabytes, bool isHugePages = false);
+    int getMegabytes();
+
+    /*
+     * write the table to a file, so a later process can load it and start out knowing everything
+     * this one learned. no search may be using the table while it is saved or loaded.
+     * saving replaces the file all at once, so a table may be saved to the file it was loaded from.
+     * loading fails and keeps the current table if the file was written by an engine
+     * that packs its entries differently, or that hashes positions with different zobrist keys
+     */
+    bool saveFile(const std::string& path);
+    bool loadFile(const std::string& path);
+
+    // a position we already evaluated, as it is handed out by the table
+    struct Entry
+    {
+        Move bestMove; // to help improve move ordering by using the last best move we calculated for this node
+        int16_t evaluation;
+        uint8_t depth; // to make sure we don't use the evaluation of a more shallowly searched node than the current node
+        uint8_t generationBound; // the search that wrote the entry in the high 6 bits, and the bound in the low 2 bits
+
+        inline Bound getBound()
+        {
+            return (Bound)(generationBound & BOUND_MASK);
+        }
+        inline int getGeneration()
+        {
+            return generationBound >> 2;
+        }
+    };
+
+    /*
+     * start a new search. the table is kept between the searches of a game, so every search
+     * starts out knowing what the last one learned, but entries from older searches are replaced first
+     */
+    void newSearch();
+    // how many out of every thousand entries were written or used by the current search
+    int getHashfull();
+
+    // return true and copy the entry if the position is in the table
+    bool probe(Zobrist hash, Entry& entry);
+    // remember what we learned about a position, replacing the least useful entry of its bucket
+    void save(Zobrist hash, Move bestMove, int evaluation, int depth, Bound bound);
+
+    /*
+     * start loading the bucket of a position into the cache.
+     * we call this as soon as a move is made, so the memory is on its way
+     * while the move generator and the evaluator do their work
+     */
+    inline void prefetch(Zobrist hash)
+    {
+        __builtin_prefetch(&buckets[getIndex(hash)]);
+    }
+
+private:
+    static const int BOUND_MASK = 0b11;
+    // the generation wraps around after this many searches
+    static const int GENERATIONS = 64;
+    // an entry one search older is worth this many plies less than an entry from the current search
+    static const int AGE_WEIGHT = 8;
+    // a bound this many plies shallower than the entry of the same position does not replace it
+    static const int SHALLOW_DEPTH = 3;
+
+    /*
+     * every search thread reads and writes the table at the same time, without any locks.
+     * an entry is packed into one 64 bit word of data, and it is stored next to the zobrist hash
+     * of its position xor the data. a thread can be interrupted between writing the two words,
+     * or two threads can write the same slot at once, and the slot ends up with the key of one
+     * entry and the data of another. that torn slot no longer xors back to the hash of either
+     * position, so it is never found, and the search just sees an empty slot.
+     * the words are atomic so the compiler keeps every load and store in one piece,
+     * but they are relaxed, because the xor check is all the synchronization we need
+     * https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+     */
+    struct Slot
+    {
+        std::atomic<uint64_t> key; // the zobrist hash of the position xor the data
+        std::atomic<uint64_t> data;
+    };
+    static const int BUCKET_SIZE = 4;
+    struct Bucket
+    {
+        Slot slots[BUCKET_SIZE];
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket must fill exactly one cache line");
+
+    /*
+     * the data of an entry, from the lowest bits to the highest:
+     * the best move without its 9 unused bits, the evaluation, the depth, and the generation and bound.
+     * the data of an empty slot is zero
+     */
+    static inline uint64_t pack(Entry& entry)
+    {
+        return (uint64_t)(entry.bestMove >> 9) |
+               (uint64_t)(uint16_t)entry.evaluation << 23 |
+               (uint64_t)entry.depth << 39 |
+               (uint64_t)entry.generationBound << 47;
+    }
+    static inline Entry unpack(uint64_t data)
+    {
+        Entry entry;
+        entry.bestMove = (Move)(data & 0x7fffff) << 9;
+        entry.evaluation = (int16_t)(uint16_t)(data >> 23);
+        entry.depth = (uint8_t)(data >> 39);
+        entry.generationBound = (uint8_t)(data >> 47);
+        return entry;
+    }
+
+    // transparent huge pages are this big, so the buckets start on a huge page boundary
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    // the first page of a table file, everything after it is the buckets exactly as they are in memory
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotSize;
+        uint32_t bucketSize;
+        uint32_t keyScheme;
+        uint64_t zobristFingerprint; // every zobrist key mixed into one number
+        uint64_t numBuckets;
+        uint32_t generation;
+    };
+    static const uint32_t FILE_VERSION = 1;
+    // a position is checked with its full hash xor the packed data, and its bucket is picked by multiply shift
+    static const uint32_t KEY_SCHEME = 1;
+    // the header takes up a whole page, so the buckets in the file line up with the pages they are mapped to
+    static const size_t HEADER_SIZE = 4096;
+    static_assert(sizeof(FileHeader) <= HEADER_SIZE, "the file header must fit in its page");
+    // the table is written in pieces this big, so even a huge table is written in a few large writes
+    static const size_t WRITE_CHUNK = 64 * 1024 * 1024;
+    // the header of a file written by this table
+    FileHeader getFileHeader();
+
+    int megabytes = 0;
+    uint64_t numBuckets = 0;
+    // the mapping we got from the operating system, and the buckets lined up inside of it
+    void* memory = nullptr;
+    size_t memorySize = 0;
+    Bucket* buckets = nullptr;
+
+    /*
+     * map fresh memory for the given number of megabytes of buckets, and only then let go of the old
+     * buckets, so the table is never left without memory. the operating system hands out zeroed pages
+     * when they are first touched
+     */
+    void allocate(int megabytes, bool isHugePages);
+    void release();
+
+    // the current search, stored in every entry it writes
+    int generation = 0;
+
+    /*
+     * map the hash onto the buckets without a division. the product of the hash and the
+     * number of buckets is between zero and the number of buckets times 2^64, so its
+     * high 64 bits are a bucket index, picked by the high bits of the hash
+     */
+    inline uint64_t getIndex(Zobrist hash)
+    {
+        return (uint64_t)(((unsigned __int128)hash * numBuckets) >> 64);
+    }
+
+    /*
+     * how much we want to keep an entry. the least useful entry of a bucket is replaced first.
+     * depth counts the most, then how many searches ago the entry was last used, then the bound.
+     * the bounds are ordered from least to most useful: an upper bound has no best move,
+     * a lower bound does, and an exact score can be used with any window
+     */
+    inline int getWorth(Entry& entry)
+    {
+        if (entry.getBound() == NO_BOUND)
+        {
+            return -GENERATIONS * AGE_WEIGHT;
+        }
+        int age = (generation - entry.getGeneration() + GENERATIONS) % GENERATIONS;
+        return entry.depth - age * AGE_WEIGHT + entry.getBound();
+    }
+};
+
+#endif //DEEPENING1_TRANSPOSITIONTABLE_H